@@ -0,0 +1,70 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+// Adaptive sample/report interval driven by activity on the raw HX711 stream.
+// While the feeder is being filled or knocked around the interval drops to the fast
+// limit; once the signal is flat it doubles on every quiet sample up to the slow limit.
+// tools/adaptive replays recorded traces through it against the fixed-rate schedule.
+
+#include <stdint.h>
+#include <math.h>
+
+class AdaptiveRate {
+public:
+  AdaptiveRate() : fast(200), slow(10000), threshold(2000), cur(200),
+                   mean(0), var(0), prev(0), prevT(0), primed(false), moving(true) {}
+
+  // fast/slow intervals in msecs
+  void limits(uint32_t lo, uint32_t hi) {
+    fast = lo;
+    slow = hi < lo ? lo : hi;
+    if (cur < fast) cur = fast;
+    if (cur > slow) cur = slow;
+  }
+  // raw counts (step, stddev or counts/s of slope) that count as activity
+  void setThreshold(int32_t counts) { threshold = counts > 0 ? counts : 1; }
+
+  // feed a raw sample taken at t msecs; returns the interval until the next sample
+  uint32_t sample(uint32_t t, int32_t raw) {
+    if (!primed) {
+      mean = prev = raw;
+      prevT = t;
+      primed = true;
+      moving = true;
+      cur = fast;
+      return cur;
+    }
+    // exponentially weighted mean and variance
+    float d = raw - mean;
+    mean += ALPHA * d;
+    var = (1 - ALPHA) * (var + ALPHA * d * d);
+    float step = fabsf((float)raw - prev);
+    float dt = (t - prevT) / 1000.0f;
+    float slope = dt > 0 ? step / dt : 0;
+    prev = raw;
+    prevT = t;
+
+    moving = step > threshold || slope > threshold || sqrtf(var) > threshold;
+    if (moving) {
+      cur = fast;
+    } else {
+      cur = cur * 2 > slow ? slow : cur * 2;
+    }
+    return cur;
+  }
+
+  uint32_t interval() const { return cur; }
+  bool active() const { return moving; }
+  float stddev() const { return sqrtf(var); }
+
+private:
+  static constexpr float ALPHA = 0.25f;
+  uint32_t fast, slow;
+  int32_t threshold;
+  uint32_t cur;
+  float mean, var, prev;
+  uint32_t prevT;
+  bool primed, moving;
+};
+
+#endif
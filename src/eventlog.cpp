@@ -0,0 +1,145 @@
+#ifdef WIFI
+#include "include.h"
+
+// /events delivery with Last-Event-ID replay.
+// Every event is serialized once into a shared SSE frame and kept in a ring of the last
+// EVENTS_BACKLOG, keyed by consecutive ids (the measurement seq plus a per-boot base).
+// Each connected client has a cursor into the ring, and serviceEvents() (from loop())
+// moves it forward a batch at a time while the client's queue has room. Live events and a reconnect's replay use
+// the same path: they arrive in order, the frames are shared, and a large backlog never
+// holds up the AsyncTCP task. A client whose next id has aged out of the ring, or was
+// from before a restart, gets a "gap" event naming the missing ids, then continues from
+// the oldest kept event.
+
+struct BacklogEntry {
+  uint32_t id;
+  AsyncEvent_SharedData_t frame;
+};
+static BacklogEntry backlog[EVENTS_BACKLOG];
+static size_t backlogOldest = 0, backlogCount = 0;  // only touched from loop()
+
+// Ids never repeat across reboots: each boot starts above every id the last one could
+// have used, handed out EVENTS_ID_BLOCK at a time from a high-water mark in preferences
+// (one flash write per block). So a stale Last-Event-ID is always older than this boot's
+// events, and a collector can key on node and id.
+static uint32_t idBase = 0, idReserved = 0;
+static bool idLoaded = false;
+
+struct EventClient {
+  AsyncEventSourceClient *client;
+  uint32_t lastId;  // Last-Event-ID at connect, resolved to a cursor by serviceEvents()
+  uint32_t next;    // next id to send; 0 for an id we never issued
+  bool resolved;
+};
+static EventClient eventClients[EVENTS_MAX_CLIENTS];
+// clients over the limit, closed by serviceEvents(): closing one inside onConnect would
+// run onDisconnect (and the library's own disconnect handling) re-entrantly on the AsyncTCP task.
+// If this is full too, the extra client stays open but is never sent anything.
+static AsyncEventSourceClient *rejectedClients[EVENTS_MAX_CLIENTS];
+// held while loop() writes to or closes clients, so onDisconnect can't free one under it.
+// Recursive because close() can call onDisconnect synchronously on the same task.
+static std::recursive_mutex eventClientsLock;
+
+static uint32_t oldestId() { return backlog[backlogOldest].id; }
+static uint32_t newestId() { return backlog[(backlogOldest + backlogCount - 1) % EVENTS_BACKLOG].id; }
+
+static bool sendGap(EventClient &c, uint32_t from, uint32_t to) {
+  char data[48];
+  snprintf(data, sizeof(data), "{\"from\":%lu,\"to\":%lu}", (unsigned long)from, (unsigned long)to);
+  return c.client->send(data, "gap");
+}
+
+void eventsBegin() {
+  events.onConnect([](AsyncEventSourceClient *client) {
+    if (client->lastId()) {
+      Serial.printf("Client reconnected! Last message ID that it got is: %lu\n", (unsigned long)client->lastId());
+    }
+    // send event with message "hello!" and no id (so the client keeps its Last-Event-ID),
+    // and set reconnect delay to 1 second
+    client->send("hello!", NULL, 0, 1000);
+    {
+      std::lock_guard<std::recursive_mutex> lock(eventClientsLock);
+      for (auto &c : eventClients) {
+        if (c.client == nullptr) {
+          c = {client, client->lastId(), 0, false};
+          return;
+        }
+      }
+      for (auto &r : rejectedClients) {
+        if (r == nullptr) {
+          r = client;
+          break;
+        }
+      }
+    }
+    log::toAll("too many /events clients");
+  });
+  events.onDisconnect([](AsyncEventSourceClient *client) {
+    std::lock_guard<std::recursive_mutex> lock(eventClientsLock);
+    for (auto &c : eventClients) {
+      if (c.client == client) c.client = nullptr;
+    }
+    for (auto &r : rejectedClients) {
+      if (r == client) r = nullptr;
+    }
+  });
+}
+
+void eventsPublish(uint32_t seq, const char *event, const String &data) {
+  // loaded here rather than in eventsBegin(): samples are published before the web server starts
+  if (!idLoaded) {
+    idBase = idReserved = preferences.getUInt("eventid", 0);
+    idLoaded = true;
+  }
+  uint32_t id = idBase + seq;
+  if (id > idReserved) {
+    idReserved = id - 1 + EVENTS_ID_BLOCK;
+    preferences.putUInt("eventid", idReserved);
+  }
+  // ids must run consecutively for cursor arithmetic; if not, start the ring over
+  if (backlogCount > 0 && id != newestId() + 1) backlogCount = 0;
+  String frame = "id: " + String(id) + "\nevent: " + event + "\ndata: " + data + "\n\n";
+  size_t slot = (backlogOldest + backlogCount) % EVENTS_BACKLOG;
+  backlog[slot] = {id, std::make_shared<String>(frame)};
+  if (backlogCount < EVENTS_BACKLOG) backlogCount++;
+  else backlogOldest = (backlogOldest + 1) % EVENTS_BACKLOG;
+}
+
+void serviceEvents() {
+  std::lock_guard<std::recursive_mutex> lock(eventClientsLock);
+  for (auto &r : rejectedClients) {
+    if (r == nullptr) continue;
+    AsyncEventSourceClient *client = r;
+    r = nullptr;
+    client->close();
+  }
+  if (backlogCount == 0) return;
+  uint32_t oldest = oldestId(), newest = newestId();
+  for (auto &c : eventClients) {
+    if (c.client == nullptr) continue;
+    if (!c.resolved) {
+      c.resolved = true;
+      if (c.lastId == 0) {
+        // new subscriber: live events only
+        c.next = newest + 1;
+      } else if (c.lastId <= newest) {
+        // older ids than the ring holds (aged out, or before a restart) go out as a gap below
+        c.next = c.lastId + 1;
+      } else {
+        // not an id we issued (preferences wiped, or another node's): all of it is a gap
+        c.next = 0;
+      }
+    }
+    for (int n = 0; n < EVENTS_BATCH && c.next <= newest; n++) {
+      if (c.client->packetsWaiting() >= EVENTS_BATCH) break;
+      if (c.next < oldest) {
+        if (!sendGap(c, c.next, oldest - 1)) break;
+        c.next = oldest;
+        continue;
+      }
+      if (!c.client->write(backlog[(backlogOldest + (c.next - oldest)) % EVENTS_BACKLOG].frame)) break;
+      c.next++;
+    }
+  }
+}
+#endif
@@ -0,0 +1,106 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+// HX711 health watchdog: fed with every conversion and every poll that found none ready,
+// it tracks not-ready time, stuck-value runs, rail saturation and the actual data rate,
+// and says when the chip should be power-cycled.
+
+#include <stdint.h>
+
+enum SensorFault : uint8_t {
+  SENSOR_OK,
+  SENSOR_NOT_READY,  // no conversion for NOT_READY_MS (unplugged, unpowered, dead)
+  SENSOR_STUCK,      // identical value for STUCK_RUN conversions (a live 24-bit ADC never does that)
+  SENSOR_SATURATED,  // pinned at 0x7FFFFF or 0x800000 for SATURATED_RUN conversions
+  SENSOR_SLOW        // converting, but well below the 10 SPS minimum (reported only)
+};
+
+inline const char *sensorFaultName(uint8_t f) {
+  switch (f) {
+    case SENSOR_OK: return "ok";
+    case SENSOR_NOT_READY: return "not_ready";
+    case SENSOR_STUCK: return "stuck";
+    case SENSOR_SATURATED: return "saturated";
+    case SENSOR_SLOW: return "slow";
+  }
+  return "unknown";
+}
+
+struct SensorHealth {
+  uint8_t fault;          // SensorFault
+  uint32_t notReadyMs;    // time since the last conversion
+  uint32_t notReadyRuns;  // consecutive not-ready faults without a conversion in between
+  uint32_t stuckRun;      // consecutive identical conversions
+  uint32_t saturatedRun;  // consecutive conversions at a rail
+  float sps;              // measured data rate
+  uint32_t resets;        // power cycles so far
+};
+
+class SensorWatchdog {
+public:
+  static const uint32_t NOT_READY_MS = 1000;   // 10x the slowest conversion period
+  static const uint32_t STUCK_RUN = 50;
+  static const uint32_t SATURATED_RUN = 5;
+  static const uint32_t RESET_HOLDOFF = 5000;  // min msecs between power cycles (includes settling)
+  static constexpr float MIN_SPS = 5.0f;
+
+  SensorWatchdog() : h(), last(0), lastT(0), resetT(0), primed(false) {}
+
+  void onConversion(uint32_t t, int32_t raw) {
+    if (primed) {
+      // exponentially weighted conversion interval -> samples per second
+      uint32_t dt = t - lastT;
+      if (dt > 0) h.sps = h.sps > 0 ? 0.9f * h.sps + 0.1f * (1000.0f / dt) : 1000.0f / dt;
+      h.stuckRun = raw == last ? h.stuckRun + 1 : 0;
+    }
+    h.saturatedRun = (raw == 0x7FFFFF || raw == -0x800000) ? h.saturatedRun + 1 : 0;
+    h.notReadyMs = 0;
+    h.notReadyRuns = 0;
+    last = raw;
+    lastT = t;
+    primed = true;
+    classify();
+  }
+
+  // a poll found no conversion ready
+  void onNotReady(uint32_t t) {
+    h.notReadyMs = t - lastT;
+    classify();
+  }
+
+  // true when the current fault warrants a power cycle (rate-limited by RESET_HOLDOFF)
+  bool needsReset(uint32_t t) const {
+    bool hard = h.fault == SENSOR_NOT_READY || h.fault == SENSOR_STUCK || h.fault == SENSOR_SATURATED;
+    return hard && t - resetT >= RESET_HOLDOFF;
+  }
+
+  // after power_down()/power_up(); run counters restart so the fault must recur
+  void onReset(uint32_t t) {
+    if (h.fault == SENSOR_NOT_READY) h.notReadyRuns++;
+    h.resets++;
+    h.stuckRun = h.saturatedRun = 0;
+    resetT = t;
+    lastT = t;  // not-ready time restarts from the power cycle
+    h.notReadyMs = 0;
+    primed = false;
+    classify();
+  }
+
+  const SensorHealth &health() const { return h; }
+
+private:
+  SensorHealth h;
+  int32_t last;
+  uint32_t lastT, resetT;
+  bool primed;
+
+  void classify() {
+    if (h.notReadyMs >= NOT_READY_MS) h.fault = SENSOR_NOT_READY;
+    else if (h.saturatedRun >= SATURATED_RUN) h.fault = SENSOR_SATURATED;
+    else if (h.stuckRun >= STUCK_RUN) h.fault = SENSOR_STUCK;
+    else if (h.sps > 0 && h.sps < MIN_SPS) h.fault = SENSOR_SLOW;
+    else h.fault = SENSOR_OK;
+  }
+};
+
+#endif
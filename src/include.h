@@ -17,15 +17,30 @@ extern WebServer server;
 //extern EventSource events;
 #endif // ELEGANTOTA_USE_ASYNC_WEBSERVER
 extern bool serverStarted;
-extern String host;
-extern JsonDocument readings;
-extern int timerDelay;
 #define HTTP_PORT 80
 #define DRD_TIMEOUT 10
-bool setupWifi();
+// long-poll clients parked on /readings?since=<seq>
+#define LONGPOLL_MAX 8
+#define LONGPOLL_TIMEOUT 30000
+// non-blocking network bring-up (network.cpp)
+#define NET_CONNECT_TIMEOUT 15000
+#define NET_BACKOFF_MIN 1000
+#define NET_BACKOFF_MAX 60000
+bool wifiBegin();
+void networkBegin();
+void networkLoop(unsigned long now);
 void resetWifi();
 void startWebServer();
 String getSensorReadings();
+void serviceLongPolls(unsigned long now);
+// /events backlog for Last-Event-ID replay (eventlog.cpp)
+#define EVENTS_BACKLOG 64      // serialized events kept, about 200 bytes each
+#define EVENTS_MAX_CLIENTS 16
+#define EVENTS_BATCH 8         // frames queued per client per loop() pass
+#define EVENTS_ID_BLOCK 4096   // event ids reserved per preferences write
+void eventsBegin();
+void eventsPublish(uint32_t seq, const char *event, const String &data);
+void serviceEvents();
 #endif
 
 #ifdef WEBSERIAL
@@ -41,24 +56,102 @@ extern NetWizard NW;
 #endif
 
 #include "logto.h"
+#include "snapshot.h"
+#include "adaptive.h"
+#include "stability.h"
 
 extern Preferences preferences;
 extern File consLog;
 
-// weight value from load cell
-extern long loadcell;
-extern long empty_offset;
-extern long full_raw;
+// Latest sample, published by loop() and read from any task through measurement.get()
+struct Measurement {
+  uint32_t seq;          // incremented for every new sample, sent as "seq" in readings
+  int32_t raw;           // HX711 counts
+  int32_t loadcell;      // feed level 0-100%
+  uint64_t lastUpdate;   // Unix ms of the sample once a browser sent /browsertime, else millis()
+  uint32_t interval;     // current adaptive sample interval, msecs
+  bool active;           // signal is moving (refill, swinging feeder)
+  bool stable;           // load has settled (see StabilityWindow)
+  int32_t stableLoadcell; // feed level from the last settled window, held while unsettled
+  bool settled;           // a window has settled since boot, so stableLoadcell is valid
+};
+extern Published<Measurement> measurement;
+
+// Settings that may be changed from loop(), WebSerial or HTTP handlers;
+// read with config.get(), change with config.update([](Config &c) { ... })
+#define HOSTNAME_LEN 32
+struct Config {
+  int32_t empty_offset;  // raw value for empty feeder
+  int32_t full_raw;      // raw value for full feeder
+  int32_t timerDelay;    // msecs between samples when the signal is flat (slowest rate)
+  int32_t fastDelay;     // msecs between samples during activity (fastest rate)
+  int32_t stableWindow;  // msecs of raw samples the settling detector looks at
+  int32_t stableSpread;  // max-min raw counts within the window that still count as settled
+  int32_t stableSlope;   // raw counts per second of drift that still count as settled
+  char host[HOSTNAME_LEN];
+};
+extern Published<Config> config;
+void setHostname(const String& name);
 
 void configTare(const String& type);
 
+// minute/hour/day rollups of the feed level (rollup.cpp)
+#define ROLLUP_MIN_EPOCH 1600000000 // ignore samples until SNTP has set the clock
+#define NTP_SERVER "pool.ntp.org"
+void rollupBegin();
+void rollupSample(long value);
+void rollupHistory(Print &out, uint32_t res, uint32_t from, uint32_t to);
+
 // Timer variables
 #define DEFDELAY 1000
+#define DEFFASTDELAY 200
+#define MINFASTDELAY 50
+// raw counts of step, slope (per second) or stddev that count as activity
+#define ACTIVITY_COUNTS 2000
+// settling detector defaults
+#define STABLE_CAPACITY 64    // samples; at 80 SPS this caps the window at 0.8 s
+#define DEFSTABLEWINDOW 1500
+#define DEFSTABLESPREAD 2000
+#define DEFSTABLESLOPE 1000
+#define CALIBRATE_TIMEOUT 4000 // msecs calibration waits for the load to settle
 extern unsigned long lastTime;
-extern int timerDelay;
 extern int minReadRate;
-// store last update based on clock time from client browser
-extern unsigned long lastUpdate, updateTime;
+// browser clock (Unix ms) minus uptime ms when /browsertime arrived, 0 until then;
+// a 64-bit uptime from esp_timer so it holds across the millis() wrap
+#include <esp_timer.h>
+extern std::atomic<int64_t> clockOffset;
+inline uint64_t clockNow() {
+  int64_t offset = clockOffset;
+  return offset ? (uint64_t)(offset + esp_timer_get_time() / 1000) : millis();
+}
 
 #include <HX711.h>
-extern HX711 LoadCell;
\ No newline at end of file
+extern HX711 LoadCell;
+
+// non-blocking HX711 access with a health watchdog (sensor.cpp)
+#include "health.h"
+#define SENSOR_STALE 1000    // conversions older than this are not used for samples
+struct SensorSample {
+  int32_t raw;
+  uint32_t seq;          // conversion counter
+  uint32_t time;         // millis() of the conversion
+  SensorHealth health;
+  bool stable;           // window settled and the sensor healthy
+  int32_t stableRaw;     // window mean at the last settled conversion
+  int32_t spread;        // window max-min
+  float slope;           // window slope, counts per second
+};
+void sensorPoll();
+SensorSample sensorGet();
+String sensorStatus();
+
+// noise characterization capture (noisecap.cpp, analysis in noise.h)
+#define NOISE_MAX_SAMPLES 4096  // 16 KB ring while capturing: the spectrum and /noise.csv use the last ones
+#define NOISE_DEFAULT_SECS 300
+#define NOISE_MAX_SECS 3600
+void noiseStart(uint32_t seconds);
+void noiseStop();
+void noiseSample(uint32_t t, int32_t raw);
+void noiseLoop();
+String noiseReport();
+String noiseStatus();
\ No newline at end of file
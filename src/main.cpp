@@ -22,7 +22,6 @@ File consLog;
 Preferences preferences;
 
 bool wifiEnabled = false;
-int timerDelay = 1000;
 unsigned long lastTime = 0;
 
 // HX711 circuit wiring
@@ -32,37 +31,83 @@ HX711 LoadCell;
 
 unsigned long t = 0;
 float calibrationValue=1.0; // calibration value (see example file "Calibration.ino")
-long loadcell=0;
-long empty_offset = 0; // offset value for empty feeder
-long full_raw = -420000; // offset value for full feeder (remember it's in tension so "reverse")
+Published<Measurement> measurement;
+// full_raw defaults to -420000 (remember it's in tension so "reverse")
+Published<Config> config;
+
+void setHostname(const String& name) {
+  config.update([&](Config &c) { strlcpy(c.host, name.c_str(), sizeof(c.host)); });
+}
+
+// raw HX711 counts to feed level 0-100%
+static long scaleRaw(long raw, const Config &cfg) {
+  long level = map(raw, cfg.empty_offset, cfg.full_raw, 0, 100);
+  if (level > 100) level = 100;
+  if (level < 0) level = 0;
+  return level;
+}
 
 // Configure tare offset values, calculate and save to preferences:
+// both use the settled window mean, so a swinging feeder can't be calibrated.
+// configTare() only asks; calibrateLoop() (from loop()) waits for a settled conversion
+// without blocking and logs the result, so /config and WebSerial answer right away.
+enum CalibrateType : uint8_t { CALIBRATE_NONE, CALIBRATE_EMPTY, CALIBRATE_FULL };
+static std::atomic<uint8_t> calibrateRequest(CALIBRATE_NONE);
+
 void configTare(const String& type) {
-  log::toAll("Calculating " + type + " offset value...");
-  if (type == "empty") {
-    empty_offset = LoadCell.read();
+  if (type == "empty") calibrateRequest = CALIBRATE_EMPTY;
+  else if (type == "full") calibrateRequest = CALIBRATE_FULL;
+}
+
+static void calibrateLoop() {
+  static uint8_t running = CALIBRATE_NONE;
+  static uint32_t start = 0, afterSeq = 0;
+  uint8_t req = calibrateRequest.exchange(CALIBRATE_NONE);
+  if (req != CALIBRATE_NONE) {
+    if (running != CALIBRATE_NONE) {
+      log::toAll("calibration already running");
+    } else {
+      running = req;
+      start = millis();
+      afterSeq = sensorGet().seq;
+      log::toAll(String("Calculating ") + (running == CALIBRATE_EMPTY ? "empty" : "full") + " offset value...");
+    }
+  }
+  if (running == CALIBRATE_NONE) return;
+  String type = running == CALIBRATE_EMPTY ? "empty" : "full";
+  // a settled conversion taken after the request
+  SensorSample s = sensorGet();
+  if (s.seq == afterSeq || !s.stable) {
+    if (millis() - start >= CALIBRATE_TIMEOUT) {
+      log::toAll("load did not settle (" + sensorStatus() + "), " + type + " offset unchanged");
+      running = CALIBRATE_NONE;
+    }
+    return;
+  }
+  log::toAll("settled: spread " + String(s.spread) + ", slope " + String(s.slope, 0) + "/s");
+  if (running == CALIBRATE_EMPTY) {
+    long empty_offset = s.stableRaw;
+    config.update([&](Config &c) { c.empty_offset = empty_offset; });
     preferences.putLong("empty_offset", empty_offset);
     log::toAll("New empty offset value: " + String(empty_offset));
-  } else if (type == "full") {
-    static long totalRaw = 0;
-    int i = 0;
-    while (i<10) {
-      // take 10 samples
-      if (LoadCell.is_ready()) {
-        long raw = LoadCell.read();   
-        log::toAll("raw[" + String(i) + "]: " + String(raw));
-        totalRaw += raw;
-        i++;
-        delay(10);
-      }
-    }
-    full_raw = totalRaw / 10.0;
+  } else {
+    long full_raw = s.stableRaw;
+    config.update([&](Config &c) { c.full_raw = full_raw; });
     preferences.putLong("full_raw", full_raw);
-    log::toAll("total: " + String(totalRaw) + ", New full offset value: " + String(full_raw));
+    log::toAll("New full offset value: " + String(full_raw));
   }
+  running = CALIBRATE_NONE;
 }
 
 void setup() {
+  // start the load cell first: its first conversion takes 100 ms at 10 SPS, and
+  // everything below runs while it settles
+  LoadCell.begin(HX711_dout,HX711_sck);
+#ifdef HX711_RATE_PIN
+  // RATE pin wired: start at 10 SPS, loop() switches to 80 SPS during activity
+  pinMode(HX711_RATE_PIN, OUTPUT);
+  digitalWrite(HX711_RATE_PIN, LOW);
+#endif
   Serial.begin(115200); delay(300);
   //pinMode(HX711_dout, INPUT);
   //pinMode(HX711_sck, OUTPUT);
@@ -83,25 +128,32 @@ void setup() {
   }
   preferences.begin("ESPprefs", false);
   //restore the offset values from preferences:
-  empty_offset = preferences.getLong("empty_offset", 0);
-  full_raw = preferences.getLong("full_raw", 0);
-  log::toAll("loaded empty offset value " + String(empty_offset));
-  log::toAll("loaded full offset value " + String(full_raw));
-  timerDelay = preferences.getInt("timerdelay", 10000);
-  if (timerDelay<200) {
-    timerDelay = 200;
+  Config cfg = {};
+  cfg.empty_offset = preferences.getLong("empty_offset", 0);
+  cfg.full_raw = preferences.getLong("full_raw", 0);
+  log::toAll("loaded empty offset value " + String(cfg.empty_offset));
+  log::toAll("loaded full offset value " + String(cfg.full_raw));
+  cfg.timerDelay = preferences.getInt("timerdelay", 10000);
+  if (cfg.timerDelay<200) {
+    cfg.timerDelay = 200;
     preferences.putInt("timerdelay", 1000);
   }
-  log::toAll("timerDelay " + String(timerDelay));
+  log::toAll("timerDelay " + String(cfg.timerDelay));
+  cfg.fastDelay = preferences.getInt("fastdelay", DEFFASTDELAY);
+  if (cfg.fastDelay < MINFASTDELAY) cfg.fastDelay = MINFASTDELAY;
+  log::toAll("fastDelay " + String(cfg.fastDelay));
+  cfg.stableWindow = preferences.getInt("stablewin", DEFSTABLEWINDOW);
+  cfg.stableSpread = preferences.getInt("stablespread", DEFSTABLESPREAD);
+  cfg.stableSlope = preferences.getInt("stableslope", DEFSTABLESLOPE);
+  log::toAll("stable within " + String(cfg.stableSpread) + " counts, " + String(cfg.stableSlope) + " counts/s over "
+             + String(cfg.stableWindow) + " msecs");
+  strlcpy(cfg.host, preferences.getString("hostname", "coopfeederBETA").c_str(), sizeof(cfg.host));
 #ifdef WIFI
-  host = preferences.getString("hostname", host);
-  log::toAll("hostname: " + host);
+  log::toAll("hostname: " + String(cfg.host));
 #endif
+  config.set(cfg);
   wifiEnabled = preferences.getBool("wifi", true);
 
-  // start the load cell
-  LoadCell.begin(HX711_dout,HX711_sck);
-
 #ifdef WIFI
   bool doubleReset = preferences.getBool("DRD", false);
 
@@ -116,54 +168,21 @@ void setup() {
     }
     //} else {
       preferences.putBool("DRD", true);
-      bool wifiConnected = setupWifi();
-      // Start the web server regardless of WiFi connection status
-      // In fallback mode, it will serve from AP mode
-      startWebServer();
-      
-#ifdef ELEGANTOTA
-      ElegantOTA.begin(&server);
-#endif
-#ifdef WEBSERIAL
-      WebSerial.begin(&server);
-      // Attach a callback function to handle incoming messages
-      WebSerial.onMessage(WebSerialonMessage);
-#endif
-      serverStarted = true;
-      
-      if (wifiConnected) {
-        log::toAll("HTTP server started @" + WiFi.localIP().toString());
-      } else {
-        log::toAll("HTTP server started in AP mode @" + WiFi.softAPIP().toString());
-      }
-      if (!MDNS.begin(host.c_str()))
-        log::toAll(F("Error starting MDNS responder"));
-      else {
-        log::toAll("MDNS started " + host);
-      }
-      // Add service to MDNS-SD
-      if (!MDNS.addService("http", "tcp", HTTP_PORT))
-        log::toAll("MDNS add service failed");
-      int n = MDNS.queryService("http", "tcp");
-      if (n == 0) {
-        log::toAll("No services found");
-      } else {
-        for (int i = 0; i < n; i++) {
-          log::toAll("mdns service: " + MDNS.hostname(i) + " (" + String(MDNS.IP(i)) + ":" + String(MDNS.port(i)) + ")");
-        }
-      }
+      // connects in the background; loop() steps it with networkLoop()
+      networkBegin();
     //}
   }
 #endif // WIFI
+  log::toAll("setup done " + String(millis()) + " ms after boot");
   consLog.flush();
 } // setup()
 
 void loop() {
 #ifdef ELEGANTOTA
-  ElegantOTA.loop();
+  if (serverStarted) ElegantOTA.loop();
 #endif
 #ifdef WEBSERIAL
-  WebSerial.loop();
+  if (serverStarted) WebSerial.loop();
 #endif
 #ifdef NETWIZARD
   NW.loop();
@@ -181,45 +200,87 @@ void loop() {
     drdCleared = true;
     log::toAll("DRD timeout - cleared double reset flag");
   }
+  if (wifiEnabled) networkLoop(now);
 #endif
-  if (now - lastEventTime > timerDelay || lastEventTime == 0) {
+  Config cfg = config.get();
+  // sample interval adapts between fastDelay (activity) and timerDelay (flat signal)
+  static AdaptiveRate rate;
+  rate.limits(cfg.fastDelay, cfg.timerDelay);
+  rate.setThreshold(ACTIVITY_COUNTS);
+  // pick up a waiting conversion, if any; never blocks
+  sensorPoll();
+  if (now - lastEventTime > rate.interval() || lastEventTime == 0) {
     lastEventTime = now;
-    // check load cell
-    static boolean newDataReady = 0;
-    // check for new data/start next conversion:
-    if (LoadCell.is_ready()) {
-      newDataReady = true;
-    }
-    if (newDataReady) {
-      long raw = LoadCell.read();
-      loadcell = map(raw, empty_offset, full_raw, 0, 100);
-      if (loadcell > 100) loadcell = 100;
-      if (loadcell < 0) loadcell = 0;
-      newDataReady = false;
-      log::toAll("[" + String(now) + "] raw: " + String(raw) + " scaled: " + String(loadcell));
-#if WIFI
-      readings["loadcell"] = String(loadcell);
-      readings["units"] = "%";
-      
-      // Calculate current time based on browser timestamp plus elapsed time
-      if (updateTime > 0) {
-        // Use the browser's timestamp as base and add elapsed milliseconds
-        // This gives us a proper Unix timestamp in milliseconds
-        lastUpdate = updateTime + (now - lastEventTime);
-      } else {
-        // If updateTime is not set yet, use the current time as a fallback
-        // But this will be incorrect since ESP32 millis() is not a Unix timestamp
-        lastUpdate = now;
+    // use the latest conversion if it is new and fresh
+    static uint32_t lastSensorSeq = 0;
+    SensorSample s = sensorGet();
+    if (s.seq != lastSensorSeq && millis() - s.time < SENSOR_STALE) {
+      lastSensorSeq = s.seq;
+      long raw = s.raw;
+      long loadcell = scaleRaw(raw, cfg);
+      // history only gets settled values
+      static long stableLoadcell = 0;
+      static bool settled = false;
+      if (s.stable) {
+        settled = true;
+        stableLoadcell = scaleRaw(s.stableRaw, cfg);
+        rollupSample(stableLoadcell);
       }
-      
-      // Send the timestamp in milliseconds since epoch (Unix timestamp)
-      readings["lastUpdate"] = String(lastUpdate);
-      
-      events.send(getSensorReadings().c_str(),"new_readings" ,millis());
+      bool wasActive = rate.active();
+      rate.sample(now, raw);
+#ifdef HX711_RATE_PIN
+      // 80 SPS while active, 10 SPS otherwise
+      if (rate.active() != wasActive) digitalWrite(HX711_RATE_PIN, rate.active() ? HIGH : LOW);
+#endif
+      if (rate.active() != wasActive)
+        log::toAll(String(rate.active() ? "activity" : "quiet") + ", sampling every " + String(rate.interval()) + " msecs");
+      // report while active, when the level or stability changes, or as a heartbeat every timerDelay
+      static unsigned long lastReport = 0;
+      static long lastReported = -1;
+      static bool lastStable = false;
+      if (rate.active() || loadcell != lastReported || s.stable != lastStable || now - lastReport >= (unsigned long)cfg.timerDelay) {
+        lastReport = now;
+        lastReported = loadcell;
+        lastStable = s.stable;
+        log::toAll("[" + String(now) + "] raw: " + String(raw) + " scaled: " + String(loadcell) + (s.stable ? " stable" : " settling"));
+        Measurement m = measurement.get();
+        m.seq++;
+        m.raw = raw;
+        m.loadcell = loadcell;
+        m.active = rate.active();
+        m.stable = s.stable;
+        m.stableLoadcell = stableLoadcell;
+        m.settled = settled;
+        m.interval = rate.interval();
+        // Unix ms from the browser's clock; plain millis() until a browser has sent it
+        m.lastUpdate = clockNow();
+        // only loop() publishes measurements
+        measurement.set(m);
+        if (m.seq == 1) log::toAll("first sample " + String(now) + " ms after boot");
+#if WIFI
+        // ids follow the sample seq, so reconnecting clients can resume with Last-Event-ID
+        eventsPublish(m.seq, "new_readings", getSensorReadings());
 #endif
-      consLog.flush();
+        consLog.flush();
+      }
     }
   }
+#ifdef WIFI
+  // answer parked /readings?since= requests once there is a newer sample or they time out
+  serviceLongPolls(now);
+  // live events and Last-Event-ID replay, a batch per client per pass
+  serviceEvents();
+#endif
+  // restore the rollups from flash once the first sample is out, so they don't delay it
+  static bool rollupStarted = false;
+  if (!rollupStarted && measurement.get().seq > 0) {
+    rollupStarted = true;
+    rollupBegin();
+  }
+  // start a requested noise capture, analyze a finished one
+  noiseLoop();
+  // finish a requested empty/full calibration once the load has settled
+  calibrateLoop();
   if (Serial.available() > 0) {
     String input = "";
     while (Serial.available() > 0) {
@@ -15,7 +15,9 @@ NetWizard NW(&server);
 //NetWizardParameter nw_header(&NW, NW_HEADER, "MQTT");
 //NetWizardParameter nw_divider1(&NW, NW_DIVIDER);
 
-bool setupWifi(void) {
+// Start NetWizard without waiting: it connects (or runs its portal) in the background from
+// NW.loop() and reconnects on its own, so this is only called once.
+bool wifiBegin(void) {
   Serial.println("Starting wifi...");
 
   // ----------------------------
@@ -26,7 +28,7 @@ bool setupWifi(void) {
   // 
   // NON_BLOCKING - Connect to WiFi and proceed while portal is active in background
   // (does not block execution after autoConnect)
-  NW.setStrategy(NetWizardStrategy::BLOCKING);
+  NW.setStrategy(NetWizardStrategy::NON_BLOCKING);
 
   // Listen for connection status changes
   NW.onConnectionStatus([](NetWizardConnectionStatus status) {
@@ -112,7 +114,7 @@ bool setupWifi(void) {
     Serial.println("Device is not configured");
   }
 
-  // Start WebServer
+  // Start WebServer now so the portal is reachable before WiFi connects
   server.begin();
   return true;
 }
@@ -0,0 +1,117 @@
+#ifdef WIFI
+#include "include.h"
+
+// Network bring-up as a state machine stepped from loop(), so setup() returns right away
+// and sampling never waits on WiFi. wifiBegin() only starts a connection attempt; failed
+// attempts and lost connections are retried with exponential backoff (NetWizard does its
+// own reconnecting, so with it we only follow the link state).
+// The web server, ElegantOTA, WebSerial, mDNS and SNTP start on the first connection.
+
+enum NetState : uint8_t {
+  NET_CONNECTING,  // attempt in progress
+  NET_BACKOFF,     // waiting before the next attempt
+  NET_UP,          // connected, services running
+  NET_OFFLINE      // nothing to connect to (no credentials)
+};
+static NetState netState = NET_OFFLINE;
+static unsigned long stateAt = 0;
+static unsigned long backoff = NET_BACKOFF_MIN;
+static std::atomic<unsigned long> firstHttp(0);
+
+static void startServices() {
+  if (serverStarted) return;
+  startWebServer();
+  // time-to-first-HTTP-response: noted on the AsyncTCP task, logged from loop()
+  server.addMiddleware([](AsyncWebServerRequest *request, ArMiddlewareNext next) {
+    next();
+    unsigned long none = 0;
+    firstHttp.compare_exchange_strong(none, millis());
+  });
+#ifdef ELEGANTOTA
+  ElegantOTA.begin(&server);
+#endif
+#ifdef WEBSERIAL
+  WebSerial.begin(&server);
+  // Attach a callback function to handle incoming messages
+  WebSerial.onMessage(WebSerialonMessage);
+#endif
+  serverStarted = true;
+}
+
+static void networkUp(unsigned long now) {
+  static bool first = true;
+  log::toAll("WiFi connected @" + WiFi.localIP().toString() + " " + String(now) + " ms after boot");
+  backoff = NET_BACKOFF_MIN;
+  netState = NET_UP;
+  if (!first) return;
+  first = false;
+  // rollups are timestamped with wall-clock time
+  configTime(0, 0, NTP_SERVER);
+  Config cfg = config.get();
+  if (!MDNS.begin(cfg.host))
+    log::toAll(F("Error starting MDNS responder"));
+  else {
+    log::toAll("MDNS started " + String(cfg.host));
+  }
+  // Add service to MDNS-SD
+  if (!MDNS.addService("http", "tcp", HTTP_PORT))
+    log::toAll("MDNS add service failed");
+  startServices();
+  log::toAll("HTTP server started @" + WiFi.localIP().toString());
+}
+
+void networkBegin() {
+  if (!wifiBegin()) {
+    // Start the web server regardless of WiFi connection status
+    startServices();
+    log::toAll("HTTP server started without WiFi");
+    return;
+  }
+  netState = NET_CONNECTING;
+  stateAt = millis();
+}
+
+void networkLoop(unsigned long now) {
+  bool connected = WiFi.status() == WL_CONNECTED;
+  switch (netState) {
+    case NET_CONNECTING:
+      if (connected) {
+        networkUp(now);
+#ifndef NETWIZARD
+      } else if (now - stateAt > NET_CONNECT_TIMEOUT || WiFi.status() == WL_CONNECT_FAILED || WiFi.status() == WL_NO_SSID_AVAIL) {
+        log::toAll("WiFi connect failed, retry in " + String(backoff / 1000) + " s");
+        netState = NET_BACKOFF;
+        stateAt = now;
+#endif
+      }
+      break;
+    case NET_BACKOFF:
+      if (now - stateAt >= backoff) {
+        backoff = backoff * 2 > NET_BACKOFF_MAX ? NET_BACKOFF_MAX : backoff * 2;
+        wifiBegin();
+        netState = NET_CONNECTING;
+        stateAt = now;
+      }
+      break;
+    case NET_UP:
+      if (!connected) {
+        log::toAll("WiFi connection lost");
+#ifdef NETWIZARD
+        netState = NET_CONNECTING;
+#else
+        // first retry right away, then back off
+        netState = NET_BACKOFF;
+        stateAt = now - backoff;
+#endif
+      }
+      break;
+    case NET_OFFLINE:
+      break;
+  }
+  static bool httpReported = false;
+  if (!httpReported && firstHttp) {
+    httpReported = true;
+    log::toAll("first HTTP response " + String(firstHttp.load()) + " ms after boot");
+  }
+}
+#endif
@@ -0,0 +1,252 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+// Load cell noise characterization of a run of raw HX711 samples: mean/variance (Welford)
+// and Allan deviation at octave-spaced averaging times, both streamed as the samples
+// arrive so a capture of any length fits in a few hundred bytes, and the strongest
+// spectral peaks from a fixed-point FFT over the last samples (mechanical resonance of
+// the hanging feeder, mains pickup).
+// No Arduino dependencies: the firmware runs it on a capture (noisecap.cpp) and
+// tools/noise runs it on recorded traces.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define NOISE_FFT_MAX 1024   // FFT points (power of two); the last ones of the capture are used
+#define NOISE_SCRATCH_WORDS (3 * NOISE_FFT_MAX)
+#define NOISE_MAX_TAUS 20   // m up to 2^19 samples: an hour at 80 SPS
+#define NOISE_PEAKS 5
+
+// streaming mean and variance
+struct Welford {
+  uint32_t n = 0;
+  double mean = 0, m2 = 0;
+  int32_t min = 0, max = 0;
+
+  void add(int32_t x) {
+    if (n == 0 || x < min) min = x;
+    if (n == 0 || x > max) max = x;
+    n++;
+    double d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+  }
+  double variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+};
+
+struct NoiseReport {
+  uint32_t samples;
+  float seconds, sps;
+  float mean, stddev;
+  int32_t min, max;
+  uint8_t taus;
+  float tau[NOISE_MAX_TAUS];   // seconds
+  float adev[NOISE_MAX_TAUS];  // raw counts
+  uint8_t peaks;
+  float peakHz[NOISE_PEAKS];
+  float peakAmp[NOISE_PEAKS];  // raw counts, sine amplitude
+  uint32_t allanUs, fftUs;     // analysis cost
+};
+
+// Streaming (non-overlapping) Allan deviation of the sample averages for m = 1, 2, 4 ...
+// samples. Level k sees one block sum of 2^k samples at a time: it adds the squared
+// difference to the previous block, then pairs blocks up and hands the pair to level k+1.
+// O(1) amortized per sample; sums are relative to the first sample to keep them small.
+struct AllanStream {
+  uint32_t n = 0;
+  int32_t origin = 0;
+  uint32_t havePrev = 0, haveHalf = 0;  // bit k: level k holds a previous block / half a pair
+  int64_t prev[NOISE_MAX_TAUS], half[NOISE_MAX_TAUS];
+  double sum[NOISE_MAX_TAUS];
+  uint32_t terms[NOISE_MAX_TAUS];
+
+  AllanStream() {
+    for (int k = 0; k < NOISE_MAX_TAUS; k++) {
+      sum[k] = 0;
+      terms[k] = 0;
+    }
+  }
+
+  void add(int32_t y) {
+    if (n++ == 0) origin = y;
+    int64_t block = (int64_t)y - origin;
+    for (int k = 0; k < NOISE_MAX_TAUS; k++) {
+      uint32_t bit = 1u << k;
+      if (havePrev & bit) {
+        double d = (double)(block - prev[k]);
+        sum[k] += d * d;
+        terms[k]++;
+      }
+      prev[k] = block;
+      havePrev |= bit;
+      if (!(haveHalf & bit)) {
+        half[k] = block;
+        haveHalf |= bit;
+        return;
+      }
+      block += half[k];
+      haveHalf &= ~bit;
+    }
+  }
+
+  // taus with at least 3 blocks (2 differences); returns how many
+  int result(float tau0, float *tau, float *adev, int maxTaus) const {
+    int out = 0;
+    for (int k = 0; k < NOISE_MAX_TAUS && out < maxTaus && terms[k] >= 2; k++) {
+      double m = (double)(1u << k);
+      tau[out] = m * tau0;
+      adev[out] = sqrt(sum[k] / (2.0 * m * m * terms[k]));
+      out++;
+    }
+    return out;
+  }
+};
+
+// everything streamed over a capture
+struct NoiseStream {
+  Welford stats;
+  AllanStream allan;
+  void add(int32_t y) {
+    stats.add(y);
+    allan.add(y);
+  }
+};
+
+// In-place radix-2 FFT on Q15-scaled integers. Each stage halves its output so nothing
+// overflows, which leaves X/n. cosT/sinT hold n/2 twiddles in Q15.
+inline void fftFixed(int32_t *re, int32_t *im, const int32_t *cosT, const int32_t *sinT, uint16_t n) {
+  for (uint16_t i = 1, j = 0; i < n; i++) {
+    uint16_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      int32_t t = re[i]; re[i] = re[j]; re[j] = t;
+      t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+  }
+  for (uint16_t len = 2; len <= n; len <<= 1) {
+    uint16_t half = len >> 1, step = n / len;
+    for (uint16_t i = 0; i < n; i += len) {
+      for (uint16_t k = 0; k < half; k++) {
+        int32_t c = cosT[k * step], s = sinT[k * step];
+        int32_t br = re[i + k + half], bi = im[i + k + half];
+        // t = b * e^(-j theta)
+        int32_t tr = (int32_t)(((int64_t)br * c + (int64_t)bi * s) >> 15);
+        int32_t ti = (int32_t)(((int64_t)bi * c - (int64_t)br * s) >> 15);
+        int32_t ar = re[i + k], ai = im[i + k];
+        re[i + k] = (ar + tr) >> 1;
+        im[i + k] = (ai + ti) >> 1;
+        re[i + k + half] = (ar - tr) >> 1;
+        im[i + k + half] = (ai - ti) >> 1;
+      }
+    }
+  }
+}
+
+// Strongest local maxima of the Hann-windowed spectrum of the last n (up to NOISE_FFT_MAX)
+// samples, strongest first. scratch needs NOISE_SCRATCH_WORDS words.
+inline int spectralPeaks(const int32_t *y, size_t count, float fs, float *hz, float *amp, int maxPeaks, int32_t *scratch) {
+  uint16_t n = NOISE_FFT_MAX;
+  while (n > count) n >>= 1;
+  if (n < 16) return 0;
+  y += count - n;
+  int32_t *re = scratch, *im = scratch + n, *cosT = scratch + 2 * n, *sinT = cosT + n / 2;
+  for (uint16_t k = 0; k < n / 2; k++) {
+    cosT[k] = (int32_t)lrintf(32767.0f * cosf(2.0f * (float)M_PI * k / n));
+    sinT[k] = (int32_t)lrintf(32767.0f * sinf(2.0f * (float)M_PI * k / n));
+  }
+  // remove the mean, then scale so the largest deviation sits just below 2^14
+  int64_t sum = 0;
+  for (uint16_t i = 0; i < n; i++) sum += y[i];
+  int32_t mean = (int32_t)(sum / n), peak = 1;
+  for (uint16_t i = 0; i < n; i++) {
+    int32_t d = y[i] - mean;
+    if (d < 0) d = -d;
+    if (d > peak) peak = d;
+  }
+  int shift = 0;  // input = deviation * 2^-shift
+  while ((peak >> shift) >= (1 << 14)) shift++;
+  if (shift == 0)
+    while (shift > -16 && (peak << (1 - shift)) < (1 << 14)) shift--;
+  for (uint16_t i = 0; i < n; i++) {
+    int32_t d = y[i] - mean;
+    d = shift >= 0 ? d >> shift : d << -shift;
+    // Hann window, also Q15: w = (1 - cos(2 pi i / n)) / 2
+    int32_t w = (32767 - cosT[(i % (n / 2))] * (i < n / 2 ? 1 : -1)) >> 1;
+    re[i] = (int32_t)(((int64_t)d * w) >> 15);
+    im[i] = 0;
+  }
+  fftFixed(re, im, cosT, sinT, n);
+  // a sine of amplitude A shows up as A/4 in a bin (n/2 spectrum, Hann gain 1/2, 1/n scaling)
+  float unit = shift >= 0 ? 4.0f * (1 << shift) : 4.0f / (1 << -shift);
+  int found = 0;
+  for (uint16_t k = 2; k < n / 2 - 1; k++) {
+    int64_t m = (int64_t)re[k] * re[k] + (int64_t)im[k] * im[k];
+    int64_t lo = (int64_t)re[k - 1] * re[k - 1] + (int64_t)im[k - 1] * im[k - 1];
+    int64_t hi = (int64_t)re[k + 1] * re[k + 1] + (int64_t)im[k + 1] * im[k + 1];
+    if (m == 0 || m <= lo || m < hi) continue;
+    float a = unit * sqrtf((float)m);
+    // keep the list strongest first: append or replace the weakest, then bubble up
+    int pos;
+    if (found < maxPeaks) pos = found++;
+    else if (a > amp[maxPeaks - 1]) pos = maxPeaks - 1;
+    else continue;
+    for (; pos > 0 && amp[pos - 1] < a; pos--) {
+      amp[pos] = amp[pos - 1];
+      hz[pos] = hz[pos - 1];
+    }
+    amp[pos] = a;
+    hz[pos] = k * fs / n;
+  }
+  return found;
+}
+
+// Report for a streamed capture taken over seconds; tail holds its last tailCount samples
+// for the spectrum. us() is a microsecond clock for the FFT cost; streamUs is what the
+// stream cost.
+template<typename Clock>
+void noiseSummarize(const NoiseStream &s, float seconds, const int32_t *tail, size_t tailCount, NoiseReport &r,
+                    int32_t *scratch, Clock us, uint32_t streamUs) {
+  r = NoiseReport();
+  r.samples = s.stats.n;
+  r.seconds = seconds;
+  r.sps = seconds > 0 && r.samples > 1 ? (r.samples - 1) / seconds : 0;
+  r.mean = s.stats.mean;
+  r.stddev = sqrt(s.stats.variance());
+  r.min = s.stats.min;
+  r.max = s.stats.max;
+  r.allanUs = streamUs;
+  if (r.sps <= 0) return;
+  r.taus = s.allan.result(1.0f / r.sps, r.tau, r.adev, NOISE_MAX_TAUS);
+  uint32_t t0 = us();
+  r.peaks = spectralPeaks(tail, tailCount, r.sps, r.peakHz, r.peakAmp, NOISE_PEAKS, scratch);
+  r.fftUs = us() - t0;
+}
+
+// Full report for count samples taken over seconds, all in memory
+template<typename Clock>
+void noiseAnalyze(const int32_t *y, size_t count, float seconds, NoiseReport &r, int32_t *scratch, Clock us) {
+  NoiseStream s;
+  uint32_t t0 = us();
+  for (size_t i = 0; i < count; i++) s.add(y[i]);
+  noiseSummarize(s, seconds, y, count, r, scratch, us, us() - t0);
+}
+
+// compact JSON report; returns the length snprintf would have written
+inline int noiseJson(char *buf, size_t len, const NoiseReport &r) {
+  auto rest = [&](int n) { return (size_t)n < len ? buf + n : buf + len; };
+  int n = snprintf(buf, len, "{\"samples\":%lu,\"seconds\":%.1f,\"sps\":%.2f,\"mean\":%.1f,\"stddev\":%.2f,\"min\":%ld,\"max\":%ld,\"adev\":[",
+                   (unsigned long)r.samples, r.seconds, r.sps, r.mean, r.stddev, (long)r.min, (long)r.max);
+  for (int i = 0; i < r.taus; i++)
+    n += snprintf(rest(n), (size_t)n < len ? len - n : 0, "%s[%.3g,%.2f]", i ? "," : "", r.tau[i], r.adev[i]);
+  n += snprintf(rest(n), (size_t)n < len ? len - n : 0, "],\"peaks\":[");
+  for (int i = 0; i < r.peaks; i++)
+    n += snprintf(rest(n), (size_t)n < len ? len - n : 0, "%s[%.3f,%.2f]", i ? "," : "", r.peakHz[i], r.peakAmp[i]);
+  n += snprintf(rest(n), (size_t)n < len ? len - n : 0, "],\"us\":{\"allan\":%lu,\"fft\":%lu}}",
+                (unsigned long)r.allanUs, (unsigned long)r.fftUs);
+  return n;
+}
+
+#endif
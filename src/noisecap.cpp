@@ -0,0 +1,140 @@
+#include "include.h"
+#include "noise.h"
+
+#include <algorithm>
+
+// Background noise capture for noise.h, started from WebSerial ("noise <secs>").
+// sensorPoll() streams every conversion into the statistics and Allan deviation while a
+// capture runs, so normal sampling and reporting carry on and a capture can run for up to
+// NOISE_MAX_SECS. The last conversions also go to a heap ring for the spectrum. When the
+// time is up, loop() finishes the analysis (the streaming and FFT cost are timed with
+// micros()), saves the ring to /noise.csv for tools/noise, frees it and publishes the
+// report for /noise. loop() also keeps the deadline and handles a stop, so a capture ends
+// on time even if the HX711 stops converting.
+
+enum NoiseState : uint8_t { NOISE_IDLE, NOISE_CAPTURING, NOISE_DONE };
+static std::atomic<uint8_t> noiseState(NOISE_IDLE);
+static std::atomic<uint32_t> noiseRequest(0);     // seconds to capture, set from WebSerial, started by loop()
+static std::atomic<uint32_t> noiseDuration(0);    // msecs from noiseStarted; set to 0 to stop early
+static std::atomic<uint32_t> noiseCount(0);
+static int32_t *noiseBuf = nullptr;  // ring of the last noiseCap conversions
+static uint32_t noiseStarted = 0;  // millis() at noiseBegin()
+static uint32_t noiseCap = 0, noiseFirst = 0, noiseLast = 0, noiseStreamUs = 0;
+static NoiseStream noiseStream;
+static Published<NoiseReport> noiseResult;
+static std::atomic<bool> noiseHaveResult(false);
+
+void noiseStart(uint32_t seconds) {
+  noiseRequest = seconds ? seconds : NOISE_DEFAULT_SECS;
+}
+
+void noiseStop() {
+  noiseDuration = 0;
+}
+
+// called by sensorPoll() for every conversion
+void noiseSample(uint32_t t, int32_t raw) {
+  if (noiseState.load(std::memory_order_acquire) != NOISE_CAPTURING) return;
+  uint32_t n = noiseCount.load(std::memory_order_relaxed);
+  if (n == 0) noiseFirst = t;
+  uint32_t start = micros();
+  noiseStream.add(raw);
+  noiseStreamUs += micros() - start;
+  noiseBuf[n % noiseCap] = raw;
+  noiseLast = t;
+  noiseCount.store(++n, std::memory_order_release);
+}
+
+static void noiseBegin(uint32_t seconds) {
+  if (seconds > NOISE_MAX_SECS) seconds = NOISE_MAX_SECS;
+  // a ring of as many samples as the heap allows, up to NOISE_MAX_SAMPLES
+  for (noiseCap = NOISE_MAX_SAMPLES; noiseCap >= 512; noiseCap /= 2) {
+    noiseBuf = (int32_t *)malloc(noiseCap * sizeof(int32_t));
+    if (noiseBuf) break;
+  }
+  if (!noiseBuf) {
+    log::toAll("noise: not enough memory for a capture");
+    return;
+  }
+  noiseCount = 0;
+  noiseStream = NoiseStream();
+  noiseStreamUs = 0;
+  noiseDuration = seconds * 1000;
+  noiseStarted = millis();
+  noiseState.store(NOISE_CAPTURING, std::memory_order_release);
+  log::toAll("noise: capturing " + String(seconds) + " s (the last " + String(noiseCap) + " samples kept for the spectrum), keep the feeder still");
+}
+
+static void noiseFinish() {
+  uint32_t n = noiseCount.load(std::memory_order_acquire);
+  if (n == 0) {
+    log::toAll("noise: no conversions captured, check the HX711");
+    free(noiseBuf);
+    noiseBuf = nullptr;
+    noiseState.store(NOISE_IDLE, std::memory_order_release);
+    return;
+  }
+  float seconds = n > 1 ? (noiseLast - noiseFirst) / 1000.0f : 0;
+  // unroll the ring, oldest first
+  uint32_t kept = n < noiseCap ? n : noiseCap;
+  if (n > noiseCap) std::rotate(noiseBuf, noiseBuf + n % noiseCap, noiseBuf + noiseCap);
+  int32_t *scratch = (int32_t *)malloc(NOISE_SCRATCH_WORDS * sizeof(int32_t));
+  if (!scratch) {
+    log::toAll("noise: not enough memory to analyze");
+  } else {
+    NoiseReport r;
+    noiseSummarize(noiseStream, seconds, noiseBuf, kept, r, scratch, micros, noiseStreamUs);
+    free(scratch);
+    noiseResult.set(r);
+    noiseHaveResult = true;
+    log::toAll("noise: " + String(n) + " samples, stddev " + String(r.stddev, 1) + " counts, analysis "
+               + String(r.allanUs) + " us streaming + " + String(r.fftUs) + " us FFT");
+    // trace for tools/noise: the kept tail, with its own duration at the capture's rate
+    File f = SPIFFS.open("/noise.csv", "w");
+    if (f) {
+      float keptSeconds = n > 1 ? seconds * (kept - 1) / (n - 1) : 0;
+      f.printf("# samples=%lu seconds=%.3f captured=%lu\n", (unsigned long)kept, keptSeconds, (unsigned long)n);
+      for (uint32_t i = 0; i < kept; i++) f.printf("%ld\n", (long)noiseBuf[i]);
+      f.close();
+    }
+  }
+  free(noiseBuf);
+  noiseBuf = nullptr;
+  noiseState.store(NOISE_IDLE, std::memory_order_release);
+}
+
+void noiseLoop() {
+  uint32_t req = noiseRequest.exchange(0);
+  if (req) {
+    if (noiseState == NOISE_IDLE) noiseBegin(req);
+    else log::toAll("noise: capture already running");
+  }
+  // the deadline, or a stop, by the clock rather than by conversions
+  if (noiseState.load(std::memory_order_acquire) == NOISE_CAPTURING && millis() - noiseStarted >= noiseDuration)
+    noiseState.store(NOISE_DONE, std::memory_order_release);
+  if (noiseState.load(std::memory_order_acquire) == NOISE_DONE) noiseFinish();
+}
+
+// JSON for /noise: capture state plus the last report, if any
+String noiseReport() {
+  char buf[1024];
+  int n = snprintf(buf, sizeof(buf), "{\"state\":\"%s\",\"captured\":%lu,\"report\":",
+                   noiseState == NOISE_IDLE ? "idle" : "capturing", (unsigned long)noiseCount.load());
+  if (noiseHaveResult) n += noiseJson(buf + n, sizeof(buf) - n - 1, noiseResult.get());
+  else n += snprintf(buf + n, sizeof(buf) - n - 1, "null");
+  if (n < (int)sizeof(buf) - 1) strcat(buf, "}");
+  return String(buf);
+}
+
+String noiseStatus() {
+  String s = noiseState == NOISE_IDLE ? "idle" : "capturing " + String(noiseCount.load()) + " samples";
+  if (!noiseHaveResult) return s;
+  NoiseReport r = noiseResult.get();
+  s += "\nlast run: " + String(r.samples) + " samples in " + String(r.seconds, 1) + " s (" + String(r.sps, 1)
+       + " SPS), stddev " + String(r.stddev, 1) + " counts, range " + String(r.max - r.min);
+  s += "\nAllan deviation (tau s: counts):";
+  for (int i = 0; i < r.taus; i++) s += " " + String(r.tau[i], 2) + ": " + String(r.adev[i], 1);
+  s += "\npeaks (Hz: counts):";
+  for (int i = 0; i < r.peaks; i++) s += " " + String(r.peakHz[i], 2) + ": " + String(r.peakAmp[i], 1);
+  return s;
+}
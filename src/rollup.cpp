@@ -0,0 +1,106 @@
+#include "include.h"
+#include "rollup.h"
+
+Rollup rollup;
+// loop() adds samples while /history reads the rings on the AsyncTCP task;
+// both hold this only for the in-RAM work, never across a flash write
+static std::mutex rollupLock;
+
+// one fixed-size file per tier; a closed record is written to slot (start / period) % slots
+// so the files never grow and a checkpoint is a single record-sized write at each tier boundary
+static const char *rollupFiles[ROLLUP_TIERS] = {"/rollup_m.bin", "/rollup_h.bin", "/rollup_d.bin"};
+static const size_t rollupSlots[ROLLUP_TIERS] = {ROLLUP_MINUTES, ROLLUP_HOURS, ROLLUP_DAYS};
+const char *rollupNames[ROLLUP_TIERS] = {"minute", "hour", "day"};
+
+static void rollupCheckpoint(int tier, const RollupRecord &r) {
+  File f = SPIFFS.open(rollupFiles[tier], "r+");
+  if (!f) {
+    log::toAll("rollup checkpoint open failed: " + String(rollupFiles[tier]));
+    return;
+  }
+  size_t slot = rollup.slot(tier, r.start, rollupSlots[tier]);
+  if (!f.seek(slot * sizeof(RollupRecord)) || f.write((const uint8_t*)&r, sizeof(r)) != sizeof(r))
+    log::toAll("rollup checkpoint write failed: " + String(rollupFiles[tier]));
+  f.close();
+}
+
+// records closed by one rollup.add(), written out once the lock is released
+static RollupRecord closedRecords[ROLLUP_TIERS];
+static int closedTiers[ROLLUP_TIERS];
+static int closedCount = 0;
+
+static void rollupClosed(int tier, const RollupRecord &r) {
+  if (closedCount < ROLLUP_TIERS) {
+    closedTiers[closedCount] = tier;
+    closedRecords[closedCount++] = r;
+  }
+}
+
+// set once rollupBegin() has restored the rings; samples before that are dropped
+static bool rollupReady = false;
+
+// reload checkpointed records (oldest first) and rebuild the open buckets;
+// missing or wrongly-sized files are recreated zero-filled.
+// Each file is read in one sequential read into a temporary buffer (14.6 KB for days).
+void rollupBegin() {
+  for (int tier = 0; tier < ROLLUP_TIERS; tier++) {
+    size_t slots = rollupSlots[tier];
+    File f = SPIFFS.open(rollupFiles[tier], "r");
+    if (!f || f.size() != slots * sizeof(RollupRecord)) {
+      if (f) f.close();
+      f = SPIFFS.open(rollupFiles[tier], "w", true);
+      RollupRecord empty;
+      empty.clear(0);
+      for (size_t i = 0; i < slots; i++) f.write((const uint8_t*)&empty, sizeof(empty));
+      f.close();
+      log::toAll("rollup created " + String(rollupFiles[tier]));
+      continue;
+    }
+    RollupRecord *recs = (RollupRecord *)malloc(slots * sizeof(RollupRecord));
+    bool ok = recs && f.read((uint8_t*)recs, slots * sizeof(RollupRecord)) == slots * sizeof(RollupRecord);
+    f.close();
+    if (!ok) {
+      log::toAll("rollup restore failed: " + String(recs ? "cannot read " : "no memory for ") + rollupFiles[tier]);
+      free(recs);
+      continue;
+    }
+    size_t n;
+    {
+      std::lock_guard<std::mutex> lock(rollupLock);
+      n = rollup.recover(tier, recs, slots);
+    }
+    free(recs);
+    log::toAll("rollup restored " + String(n) + " " + rollupNames[tier] + " records");
+  }
+  std::lock_guard<std::mutex> lock(rollupLock);
+  rollup.rebuild();
+  rollupReady = true;
+}
+
+// samples are only rolled up once SNTP has set the clock
+void rollupSample(long value) {
+  time_t now = time(nullptr);
+  if (now < ROLLUP_MIN_EPOCH || !rollupReady) return;
+  {
+    std::lock_guard<std::mutex> lock(rollupLock);
+    rollup.add((uint32_t)now, (int32_t)value, rollupClosed);
+  }
+  // at most one record per tier closes per sample
+  for (int i = 0; i < closedCount; i++) rollupCheckpoint(closedTiers[i], closedRecords[i]);
+  closedCount = 0;
+}
+
+// JSON for /history: records of the coarsest tier no finer than res seconds
+void rollupHistory(Print &out, uint32_t res, uint32_t from, uint32_t to) {
+  int tier = rollup.pick(res);
+  std::lock_guard<std::mutex> lock(rollupLock);
+  out.printf("{\"tier\":\"%s\",\"period\":%lu,\"records\":[", rollupNames[tier], (unsigned long)rollup.tiers[tier].period);
+  bool first = true;
+  rollup.query(tier, from, to, [&](const RollupRecord &r) {
+    // [start, min, max, mean, first, last, count]
+    out.printf("%s[%lu,%ld,%ld,%ld,%ld,%ld,%lu]", first ? "" : ",", (unsigned long)r.start, (long)r.min, (long)r.max,
+               (long)r.mean(), (long)r.first, (long)r.last, (unsigned long)r.count);
+    first = false;
+  });
+  out.print("]}");
+}
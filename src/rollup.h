@@ -0,0 +1,196 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+// Cascading minute/hour/day rollups of the feed level.
+// Flash checkpointing and locking live in rollup.cpp; tools/rollup replays reboots against
+// an uninterrupted run.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// one aggregated bucket; start is in seconds and aligned to the tier period
+struct RollupRecord {
+  uint32_t start;
+  int32_t min, max, first, last;
+  int64_t sum;
+  uint32_t count;   // 0 marks an empty/unused record
+
+  void clear(uint32_t s) { start = s; min = max = first = last = 0; sum = 0; count = 0; }
+  void add(int32_t v) {
+    if (count == 0) { min = max = first = v; }
+    if (v < min) min = v;
+    if (v > max) max = v;
+    last = v;
+    sum += v;
+    count++;
+  }
+  // fold a finer, later record into this one
+  void merge(const RollupRecord &r) {
+    if (r.count == 0) return;
+    if (count == 0) { min = r.min; max = r.max; first = r.first; }
+    if (r.min < min) min = r.min;
+    if (r.max > max) max = r.max;
+    last = r.last;
+    sum += r.sum;
+    count += r.count;
+  }
+  int32_t mean() const { return count ? (int32_t)(sum / (int64_t)count) : 0; }
+};
+
+// fixed-size ring of closed records for one resolution, plus the bucket being filled
+class RollupTier {
+public:
+  RollupTier(uint32_t period, RollupRecord *buf, size_t size)
+    : period(period), buf(buf), size(size), head(0), used(0) { open.clear(0); }
+
+  const uint32_t period;
+
+  uint32_t align(uint32_t t) const { return t - t % period; }
+  const RollupRecord &current() const { return open; }
+  size_t count() const { return used; }
+  // i = 0 is the oldest closed record
+  const RollupRecord &at(size_t i) const { return buf[(head + size - used + i) % size]; }
+
+  // push a closed record; the oldest one is dropped when the ring is full
+  void push(const RollupRecord &r) {
+    buf[head] = r;
+    head = (head + 1) % size;
+    if (used < size) used++;
+  }
+  // start a fresh bucket; returns true with the previous one in closed if it had data
+  bool roll(uint32_t t, RollupRecord &closed) {
+    bool had = open.count > 0;
+    if (had) {
+      closed = open;
+      push(open);
+    }
+    open.clear(align(t));
+    return had;
+  }
+  // true when time t no longer belongs to the open bucket
+  bool expired(uint32_t t) const { return open.count > 0 && align(t) != open.start; }
+  RollupRecord &bucket() { return open; }
+  void reset() { head = used = 0; open.clear(0); }
+
+private:
+  RollupRecord *buf;
+  size_t size;
+  size_t head, used;
+  RollupRecord open;
+};
+
+#define ROLLUP_TIERS 3
+#define ROLLUP_MINUTES 120 // 2 hours of minutes
+#define ROLLUP_HOURS 336   // 2 weeks of hours
+#define ROLLUP_DAYS 366    // a year of days
+
+class Rollup {
+public:
+  // called for every record that closes, e.g. to checkpoint it to flash
+  typedef void (*CloseFn)(int tier, const RollupRecord &r);
+
+  Rollup() : tiers{ RollupTier(60, minutes, ROLLUP_MINUTES),
+                    RollupTier(3600, hours, ROLLUP_HOURS),
+                    RollupTier(86400, days, ROLLUP_DAYS) } {}
+
+  RollupTier tiers[ROLLUP_TIERS];
+
+  // O(1) per sample: only the minute bucket is touched unless a boundary is crossed,
+  // in which case each closed bucket is folded into the next coarser one
+  void add(uint32_t t, int32_t v, CloseFn onClose = nullptr) {
+    // ignore samples from before the open bucket (clock stepped backwards)
+    if (tiers[0].current().count && t < tiers[0].current().start) return;
+    for (int i = 0; i < ROLLUP_TIERS; i++) advance(i, t, onClose);
+    RollupTier &minute = tiers[0];
+    if (minute.current().count == 0) minute.bucket().clear(minute.align(t));
+    minute.bucket().add(v);
+  }
+
+  // coarsest tier whose period is no larger than the requested resolution
+  int pick(uint32_t resolution) const {
+    int best = 0;
+    for (int i = 0; i < ROLLUP_TIERS; i++) {
+      if (tiers[i].period <= resolution) best = i;
+    }
+    return best;
+  }
+
+  // call f(record) for each record of tier overlapping [from, to), oldest first,
+  // including the open bucket; returns the number visited
+  template<typename F>
+  size_t query(int tier, uint32_t from, uint32_t to, F f) const {
+    const RollupTier &t = tiers[tier];
+    size_t n = 0;
+    for (size_t i = 0; i < t.count(); i++) {
+      const RollupRecord &r = t.at(i);
+      if (r.start + t.period > from && r.start < to) { f(r); n++; }
+    }
+    const RollupRecord &r = t.current();
+    if (r.count && r.start + t.period > from && r.start < to) { f(r); n++; }
+    return n;
+  }
+
+  // checkpoint slot of a closed record: start / period, modulo the number of slots
+  size_t slot(int tier, uint32_t start, size_t slots) const { return (start / tiers[tier].period) % slots; }
+
+  // recovery: each tier's checkpoint slots are replayed oldest first, then rebuild()
+  // refills each coarser open bucket from the finer closed records in its period. The
+  // finer open bucket is left alone: it is folded in when it closes, like any other record.
+  // Only records from the n periods ending at the newest one are restored; a slot still
+  // holding an older record is stale. Returns the number of records restored.
+  size_t recover(int tier, const RollupRecord *slots, size_t n) {
+    uint32_t period = tiers[tier].period, latest = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (slots[i].count && slots[i].start > latest) latest = slots[i].start;
+    }
+    size_t restored = 0;
+    for (size_t k = n; latest && k-- > 0; ) {
+      if (latest < k * period) continue;
+      uint32_t start = latest - k * period;
+      const RollupRecord &r = slots[slot(tier, start, n)];
+      if (r.count && r.start == start) {
+        restore(tier, r);
+        restored++;
+      }
+    }
+    return restored;
+  }
+  void restore(int tier, const RollupRecord &r) { tiers[tier].push(r); }
+  void rebuild() {
+    for (int i = 1; i < ROLLUP_TIERS; i++) {
+      RollupTier &fine = tiers[i - 1];
+      RollupTier &tier = tiers[i];
+      if (fine.count() == 0) continue;
+      uint32_t start = tier.align(fine.at(fine.count() - 1).start);
+      // a checkpointed coarse record already covers this period
+      if (tier.count() && tier.at(tier.count() - 1).start >= start) continue;
+      tier.bucket().clear(start);
+      for (size_t j = 0; j < fine.count(); j++) {
+        if (fine.at(j).start >= start) tier.bucket().merge(fine.at(j));
+      }
+    }
+  }
+
+private:
+  // close tier i's open bucket if time t has left it, folding the closed record into
+  // the next tier (which is first advanced to the closed record's own period)
+  void advance(int i, uint32_t t, CloseFn onClose) {
+    RollupTier &tier = tiers[i];
+    if (!tier.expired(t)) return;
+    RollupRecord closed;
+    tier.roll(t, closed);
+    if (onClose) onClose(i, closed);
+    if (i + 1 < ROLLUP_TIERS) {
+      RollupTier &next = tiers[i + 1];
+      advance(i + 1, closed.start, onClose);
+      if (next.current().count == 0) next.bucket().clear(next.align(closed.start));
+      next.bucket().merge(closed);
+    }
+  }
+
+  RollupRecord minutes[ROLLUP_MINUTES];
+  RollupRecord hours[ROLLUP_HOURS];
+  RollupRecord days[ROLLUP_DAYS];
+};
+
+#endif
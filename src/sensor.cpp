@@ -0,0 +1,65 @@
+#include "include.h"
+
+// All HX711 access goes through here. bogde's read() spins until DOUT goes low, so it is
+// only ever called right after is_ready() said a conversion is waiting; everything else
+// waits on published conversions with an explicit timeout.
+// Only loop() calls sensorPoll(); the try-lock guards against a re-entrant poll, which
+// just skips.
+
+static std::atomic_flag sensorBusy = ATOMIC_FLAG_INIT;
+static SensorWatchdog watchdog;
+static SeqLock<SensorSample> sample;
+static StabilityWindow<STABLE_CAPACITY> window;
+
+void sensorPoll() {
+  if (sensorBusy.test_and_set(std::memory_order_acquire)) return;
+  uint32_t now = millis();
+  SensorSample s = sample.load();
+  if (LoadCell.is_ready()) {
+    s.raw = LoadCell.read();
+    s.seq++;
+    s.time = now;
+    watchdog.onConversion(now, s.raw);
+    Config cfg = config.get();
+    window.tolerances(cfg.stableWindow, cfg.stableSpread, cfg.stableSlope);
+    window.add(now, s.raw);
+    noiseSample(now, s.raw);
+    s.spread = window.spread();
+    s.slope = window.slope();
+  } else {
+    watchdog.onNotReady(now);
+  }
+  SensorHealth h = watchdog.health();
+  if (watchdog.needsReset(now)) {
+    // SCK high for >60 us powers the HX711 down; it restarts a conversion cycle on power-up
+    LoadCell.power_down();
+    delayMicroseconds(100);
+    LoadCell.power_up();
+    watchdog.onReset(now);
+    window.clear();
+    log::toAll("HX711 " + String(sensorFaultName(h.fault)) + ", power cycled (" + String(watchdog.health().resets) + ")");
+    h = watchdog.health();
+  }
+  if (h.fault != s.health.fault && h.fault != SENSOR_NOT_READY)
+    log::toAll("HX711 health: " + String(sensorFaultName(h.fault)));
+  s.health = h;
+  // a stuck or railed ADC looks perfectly settled, so only a healthy one counts
+  s.stable = window.stable() && (h.fault == SENSOR_OK || h.fault == SENSOR_SLOW);
+  if (s.stable) s.stableRaw = window.mean();
+  // single writer: only the try-lock holder stores
+  sample.store(s);
+  sensorBusy.clear(std::memory_order_release);
+}
+
+SensorSample sensorGet() {
+  return sample.load();
+}
+
+String sensorStatus() {
+  SensorSample s = sensorGet();
+  const SensorHealth &h = s.health;
+  return String(s.stable ? "stable" : "settling") + " (spread " + String(s.spread) + ", slope " + String(s.slope, 0) + "/s), "
+         + String(sensorFaultName(h.fault)) + ", " + String(h.sps, 1) + " SPS, not ready " + String(h.notReadyMs)
+         + " ms, stuck run " + String(h.stuckRun) + ", saturated run " + String(h.saturatedRun)
+         + ", power cycles " + String(h.resets);
+}
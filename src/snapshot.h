@@ -0,0 +1,109 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Lock-free published state shared between loop(), WebSerial and AsyncTCP handlers.
+// tools/snapshot hammers it from host threads ("make -C tools check").
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+// A reader spins while the sequence is odd. If the writer were preempted mid-store by a
+// higher-priority task on its core (async_tcp shares core 1 with loop()), a reader in that
+// task would spin forever, so the store runs with preemption and interrupts off.
+#define SEQLOCK_MUX portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#define SEQLOCK_WRITE_BEGIN() portENTER_CRITICAL(&mux)
+#define SEQLOCK_WRITE_END() portEXIT_CRITICAL(&mux)
+#else
+#define SEQLOCK_MUX
+#define SEQLOCK_WRITE_BEGIN()
+#define SEQLOCK_WRITE_END()
+#endif
+
+// Sequence lock over a trivially copyable T.
+// Readers never block or allocate: they copy the value out and retry if a write overlapped.
+// The payload is held as relaxed atomic words so a concurrent copy is never a data race,
+// and the fences order it against the sequence counter (odd while a write is in progress).
+// store() must not be called concurrently; Published<T> below serializes writers.
+// On the ESP32 a store is a short critical section (see SEQLOCK_WRITE_BEGIN).
+template<typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+  static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+public:
+  // static constructors may run before the scheduler, so no critical section here
+  SeqLock() : seq(0) {
+    for (size_t i = 0; i < WORDS; i++) words[i].store(0, std::memory_order_relaxed);
+  }
+
+  void store(const T &v) {
+    uint32_t buf[WORDS] = {0};
+    memcpy(buf, &v, sizeof(T));
+    SEQLOCK_WRITE_BEGIN();
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) words[i].store(buf[i], std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+    SEQLOCK_WRITE_END();
+  }
+
+  T load() const {
+    uint32_t buf[WORDS];
+    uint32_t s0, s1;
+    do {
+      s0 = seq.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; i++) buf[i] = words[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      s1 = seq.load(std::memory_order_relaxed);
+    } while ((s0 & 1) || s0 != s1);
+    T v;
+    memcpy(&v, buf, sizeof(T));
+    return v;
+  }
+
+  // number of completed stores
+  uint32_t version() const { return seq.load(std::memory_order_acquire) / 2; }
+
+private:
+  std::atomic<uint32_t> seq;
+  std::atomic<uint32_t> words[WORDS];
+  SEQLOCK_MUX
+};
+
+// Read-copy-update wrapper: readers get an immutable copy through get(),
+// writers copy the current value, modify it and publish the result in one step.
+// Writers (rare: config changes, one sample per loop) take a mutex so they may come
+// from any task; readers stay lock-free.
+template<typename T>
+class Published {
+public:
+  T get() const { return value.load(); }
+  uint32_t version() const { return value.version(); }
+
+  void set(const T &v) {
+    std::lock_guard<std::mutex> lock(writer);
+    value.store(v);
+  }
+
+  // apply f(T&) to a copy of the current value and publish it; returns the new value
+  template<typename F>
+  T update(F f) {
+    std::lock_guard<std::mutex> lock(writer);
+    T v = value.load();
+    f(v);
+    value.store(v);
+    return v;
+  }
+
+private:
+  SeqLock<T> value;
+  std::mutex writer;
+};
+
+#endif
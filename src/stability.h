@@ -0,0 +1,113 @@
+#ifndef STABILITY_H
+#define STABILITY_H
+
+// Settling detector over a sliding window of raw HX711 samples, like a scale's "stable" lamp.
+// The window covers the last windowMs msecs (at most N samples). The load counts as settled
+// when the max-min spread and the least-squares slope are both within tolerance.
+// Every statistic is O(1) per sample: min/max come from monotonic deques, and the slope
+// from running integer sums over times relative to the oldest sample. The sums are shifted
+// exactly when that sample leaves the window.
+// tools/stability checks it against a brute-force window and times it.
+
+#include <stdint.h>
+
+template<uint16_t N>
+class StabilityWindow {
+public:
+  static const uint16_t MIN_SAMPLES = 5;
+  static const uint32_t MAX_WINDOW = 60000;
+
+  StabilityWindow() : window(1500), spreadTol(2000), slopeTol(1000) { clear(); }
+
+  // window in msecs, spread in raw counts, slope in raw counts per second
+  void tolerances(uint32_t windowMs, int32_t spread, int32_t slopePerSec) {
+    window = windowMs > MAX_WINDOW ? MAX_WINDOW : windowMs;
+    spreadTol = spread;
+    slopeTol = slopePerSec;
+  }
+
+  void clear() {
+    n = 0;
+    total = 0;
+    base = 0;
+    minHead = minLen = maxHead = maxLen = 0;
+    st = stt = sv = stv = 0;
+  }
+
+  void add(uint32_t t, int32_t raw) {
+    while (n > 0 && (n == N || t - times[(total - n) % N] > window)) popOldest();
+    if (n == 0) base = t;
+    uint32_t idx = total++;
+    times[idx % N] = t;
+    values[idx % N] = raw;
+    n++;
+    int64_t dt = (int64_t)(t - base);
+    st += dt;
+    stt += dt * dt;
+    sv += raw;
+    stv += dt * raw;
+    // deques hold absolute sample indices with monotonic values, extremes at the front
+    while (maxLen > 0 && values[maxAt(maxLen - 1) % N] <= raw) maxLen--;
+    maxQ[(maxHead + maxLen++) % N] = idx;
+    while (minLen > 0 && values[minAt(minLen - 1) % N] >= raw) minLen--;
+    minQ[(minHead + minLen++) % N] = idx;
+  }
+
+  uint16_t count() const { return n; }
+  int32_t min() const { return n ? values[minAt(0) % N] : 0; }
+  int32_t max() const { return n ? values[maxAt(0) % N] : 0; }
+  int32_t spread() const { return max() - min(); }
+  int32_t mean() const { return n ? (int32_t)(sv / n) : 0; }
+
+  // least-squares slope in raw counts per second
+  float slope() const {
+    int64_t den = (int64_t)n * stt - st * st;
+    if (n < 2 || den == 0) return 0;
+    return 1000.0f * (float)((int64_t)n * stv - st * sv) / (float)den;
+  }
+
+  bool stable() const {
+    float s = slope();
+    return n >= MIN_SAMPLES && spread() <= spreadTol && (s < 0 ? -s : s) <= slopeTol;
+  }
+
+private:
+  uint32_t window;
+  int32_t spreadTol, slopeTol;
+  uint32_t times[N];
+  int32_t values[N];
+  uint32_t minQ[N], maxQ[N];
+  uint16_t n, minHead, minLen, maxHead, maxLen;
+  uint32_t total;  // samples added so far; sample i lives in slot i % N
+  uint32_t base;   // time of the oldest sample, sums are relative to it
+  int64_t st, stt, sv, stv;
+
+  uint32_t minAt(uint16_t k) const { return minQ[(minHead + k) % N]; }
+  uint32_t maxAt(uint16_t k) const { return maxQ[(maxHead + k) % N]; }
+
+  void popOldest() {
+    uint32_t idx = total - n;
+    int64_t dt = (int64_t)(times[idx % N] - base);
+    int32_t v = values[idx % N];
+    st -= dt;
+    stt -= dt * dt;
+    sv -= v;
+    stv -= dt * v;
+    n--;
+    if (minLen > 0 && minAt(0) == idx) { minHead = (minHead + 1) % N; minLen--; }
+    if (maxLen > 0 && maxAt(0) == idx) { maxHead = (maxHead + 1) % N; maxLen--; }
+    if (n == 0) {
+      st = stt = sv = stv = 0;
+      return;
+    }
+    // move the time origin to the new oldest sample: sum(t-d) = St - n*d,
+    // sum((t-d)^2) = Stt - 2d*St + n*d^2, sum((t-d)*v) = Stv - d*Sv
+    int64_t d = (int64_t)(times[(idx + 1) % N] - base);
+    stt += -2 * d * st + (int64_t)n * d * d;
+    stv -= d * sv;
+    st -= (int64_t)n * d;
+    base += (uint32_t)d;
+  }
+};
+
+#endif
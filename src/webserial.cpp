@@ -18,7 +18,7 @@ String formatMacAddress(const String& macAddress) {
   return result;
 }
 
-String commandList[] = {"format", "restart", "ls", "hostname", "status", "wificonfig", "conslog", "log (on/off)", "note", "conslog (close/rm/open)", "timer (seconds)", "empty", "full"};
+String commandList[] = {"format", "restart", "ls", "hostname", "status", "wificonfig", "conslog", "log (on/off)", "note", "conslog (close/rm/open)", "timer (seconds)", "fast (msecs)", "stable (msecs spread slope)", "noise (secs/stop)", "empty", "full"};
 #define ASIZE(arr) (sizeof(arr) / sizeof(arr[0]))
 String words[10]; // Assuming a maximum of 10 words
 
@@ -85,13 +85,24 @@ void WebSerialonMessage(uint8_t *data, size_t len) {
     }
     if (words[i].startsWith("host")) {
       if (!words[++i].isEmpty()) {
-        host = words[i];
+        setHostname(words[i]);
+        String host = config.get().host;
         preferences.putString("hostname", host);
         log::toAll("hostname set to " + host);
         log::toAll("restart to change hostname");
         log::toAll("preferences " + preferences.getString("hostname"));
       } else {
-        log::toAll("hostname: " + host);
+        log::toAll("hostname: " + String(config.get().host));
+      }
+      return;
+    }
+    // noise characterization: capture raw samples in the background, report at /noise
+    if (words[i].equals("noise")) {
+      if (wordCount > 1) {
+        if (words[++i].equals("stop")) noiseStop();
+        else noiseStart(atoi(words[i].c_str()));
+      } else {
+        log::toAll("noise: " + noiseStatus());
       }
       return;
     }
@@ -99,14 +110,19 @@ void WebSerialonMessage(uint8_t *data, size_t len) {
       String buf = "";
       unsigned long uptime = millis() / 1000;
       log::toAll("      uptime: " + String(uptime));
-      log::toAll(" current raw: " + String(LoadCell.read()));
-      log::toAll("empty offset: " + String(empty_offset));
-      log::toAll(" full offset: " + String(full_raw));
+      log::toAll(" current raw: " + String(sensorGet().raw));
+      log::toAll("      sensor: " + sensorStatus());
+      Config cfg = config.get();
+      log::toAll("empty offset: " + String(cfg.empty_offset));
+      log::toAll(" full offset: " + String(cfg.full_raw));
+      Measurement m = measurement.get();
+      log::toAll("    sampling: " + String(m.active ? "active" : "quiet") + " every " + String(m.interval) + " msecs ("
+                 + String(cfg.fastDelay) + "-" + String(cfg.timerDelay) + ")");
       buf = String();
       return;
     }
     if (words[i].startsWith("wifi")) {
-      String buf = "hostname: " + host;
+      String buf = "hostname: " + String(config.get().host);
       buf += " wifi: " + WiFi.SSID();
       buf += " ip: " + WiFi.localIP().toString();
       buf += "  MAC addr: " + formatMacAddress(WiFi.macAddress());
@@ -127,11 +143,44 @@ void WebSerialonMessage(uint8_t *data, size_t len) {
     if (words[i].startsWith("timer")) {
       if (wordCount > 1) {
         // argument is seconds, timerDelay is msec
-        timerDelay = atoi(words[++i].c_str())*1000;
+        int timerDelay = atoi(words[++i].c_str())*1000;
         if (timerDelay < 200) timerDelay = 200;
+        config.update([&](Config &c) { c.timerDelay = timerDelay; });
         preferences.putInt("timerdelay", timerDelay);
       }
-      log::toAll("timer: " + String(timerDelay) + " msecs");
+      log::toAll("timer: " + String(config.get().timerDelay) + " msecs");
+      return;
+    }
+    // fastest sample interval, used while the signal is moving
+    if (words[i].startsWith("fast")) {
+      if (wordCount > 1) {
+        int fastDelay = atoi(words[++i].c_str());
+        if (fastDelay < MINFASTDELAY) fastDelay = MINFASTDELAY;
+        config.update([&](Config &c) { c.fastDelay = fastDelay; });
+        preferences.putInt("fastdelay", fastDelay);
+      }
+      log::toAll("fast timer: " + String(config.get().fastDelay) + " msecs");
+      return;
+    }
+    // settling detector: window msecs, max-min raw counts, raw counts per second
+    if (words[i].startsWith("stable")) {
+      if (wordCount > 3) {
+        int stableWindow = atoi(words[++i].c_str());
+        int stableSpread = atoi(words[++i].c_str());
+        int stableSlope = atoi(words[++i].c_str());
+        if (stableWindow < 200) stableWindow = 200;
+        config.update([&](Config &c) {
+          c.stableWindow = stableWindow;
+          c.stableSpread = stableSpread;
+          c.stableSlope = stableSlope;
+        });
+        preferences.putInt("stablewin", stableWindow);
+        preferences.putInt("stablespread", stableSpread);
+        preferences.putInt("stableslope", stableSlope);
+      }
+      Config cfg = config.get();
+      log::toAll("stable: within " + String(cfg.stableSpread) + " counts and " + String(cfg.stableSlope) + " counts/s over "
+                 + String(cfg.stableWindow) + " msecs");
       return;
     }
     /*
@@ -143,13 +192,14 @@ void WebSerialonMessage(uint8_t *data, size_t len) {
     if (words[i].startsWith("empty")) {
       if (wordCount > 1) {
         if (!words[++i].equals("?")) {
-          empty_offset = atol(words[i].c_str());
+          long empty_offset = atol(words[i].c_str());
+          config.update([&](Config &c) { c.empty_offset = empty_offset; });
           preferences.putLong("empty_offset", empty_offset);
         }
-        log::toAll("empty calibration = " + String(empty_offset));
+        log::toAll("empty calibration = " + String(config.get().empty_offset));
       } else {
         configTare("empty");
-        log::toAll("empty calibration set");
+        log::toAll("calibrating empty");
       }
       return;
     }
@@ -158,14 +208,14 @@ void WebSerialonMessage(uint8_t *data, size_t len) {
         if (!words[++i].equals("?")) {
           long l;
           if ((l = atol(words[i].c_str())) > 0) {
-            full_raw = l;
-            preferences.putLong("full_raw", full_raw);
+            config.update([&](Config &c) { c.full_raw = l; });
+            preferences.putLong("full_raw", l);
           }
         }
-        log::toAll("full offset = " + String(full_raw));
+        log::toAll("full offset = " + String(config.get().full_raw));
       } else {
         configTare("full");
-        log::toAll("full calibration set");
+        log::toAll("calibrating full");
       }
       return;
     }
@@ -5,22 +5,85 @@ AsyncWebServer server(HTTP_PORT);
 AsyncEventSource events("/events");
 AsyncWebSocket ws("/ws");
 bool serverStarted = false;
-JsonDocument readings;
 JsonDocument browserTimeData;
-String host = "coopfeederBETA";
-unsigned long lastUpdate, updateTime;
+std::atomic<int64_t> clockOffset(0);
 
+// readings JSON from one consistent snapshot; formatted on the stack, no JsonDocument
 String getSensorReadings() {
-  //readings["sensor"] = "0";
-  String jsonString;
-  serializeJson(readings,jsonString);
-  return jsonString;
+  Measurement m = measurement.get();
+  SensorHealth h = sensorGet().health;
+  // stableLoadcell only once a window has settled, rather than a made-up 0
+  char stable[32] = "";
+  if (m.settled) snprintf(stable, sizeof(stable), ",\"stableLoadcell\":\"%ld\"", (long)m.stableLoadcell);
+  char buf[200];
+  snprintf(buf, sizeof(buf), "{\"loadcell\":\"%ld\",\"units\":\"%%\",\"seq\":%lu,\"lastUpdate\":\"%llu\",\"stable\":%s%s,\"sensor\":\"%s\",\"sps\":%.1f}",
+           (long)m.loadcell, (unsigned long)m.seq, (unsigned long long)m.lastUpdate, m.stable ? "true" : "false",
+           stable, sensorFaultName(h.fault), (double)h.sps);
+  return String(buf);
+}
+
+// /readings?since=<seq> requests parked until a newer sample exists or they time out
+struct LongPoll {
+  AsyncWebServerRequestPtr request;
+  unsigned long since;
+  unsigned long parkedAt;
+  unsigned long timeout;
+};
+LongPoll longPolls[LONGPOLL_MAX];
+portMUX_TYPE longPollMux = portMUX_INITIALIZER_UNLOCKED;
+
+void sendReadings(AsyncWebServerRequest *request) {
+  AsyncWebServerResponse *response = request->beginResponse(200, "application/json", getSensorReadings());
+  // Add CORS headers
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("Access-Control-Allow-Methods", "GET");
+  response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+  request->send(response);
+}
+
+// park a request in a free slot; returns false if all LONGPOLL_MAX slots are busy
+// (weak pointers are swapped rather than assigned so nothing is freed inside the critical section)
+bool parkLongPoll(AsyncWebServerRequest *request, unsigned long since, unsigned long timeout) {
+  AsyncWebServerRequestPtr paused = request->pause();
+  bool parked = false;
+  portENTER_CRITICAL(&longPollMux);
+  for (int i = 0; i < LONGPOLL_MAX; i++) {
+    // a slot is free once its request has been answered or the client went away
+    if (longPolls[i].request.expired()) {
+      std::swap(longPolls[i].request, paused);
+      longPolls[i].since = since;
+      longPolls[i].parkedAt = millis();
+      longPolls[i].timeout = timeout;
+      parked = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&longPollMux);
+  return parked;
+}
+
+// called from loop(): answer parked requests that have a newer sample or have timed out
+void serviceLongPolls(unsigned long now) {
+  unsigned long seq = measurement.get().seq;
+  for (int i = 0; i < LONGPOLL_MAX; i++) {
+    AsyncWebServerRequestPtr ready;
+    portENTER_CRITICAL(&longPollMux);
+    if (!longPolls[i].request.expired() &&
+        (seq > longPolls[i].since || now - longPolls[i].parkedAt >= longPolls[i].timeout)) {
+      std::swap(ready, longPolls[i].request);
+    }
+    portEXIT_CRITICAL(&longPollMux);
+    // send outside the critical section
+    if (auto request = ready.lock()) {
+      sendReadings(request.get());
+    }
+  }
 }
 
 String processor(const String& var) {
   Serial.println(var);
   if(var == "TIMERDELAY") {
-    return String(timerDelay);
+    return String(config.get().timerDelay);
   }
   return String();
 }
@@ -50,17 +113,31 @@ void startWebServer() {
   });
 
   // Request latest sensor readings
+  // with ?since=<seq> the request is held until a sample newer than <seq> exists
+  // (or ?timeout=<ms>, default/max LONGPOLL_TIMEOUT, expires) so pollers don't spin
   server.on("/readings", HTTP_GET, [](AsyncWebServerRequest *request) {
-    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", getSensorReadings());
-    // Add CORS headers
-    response->addHeader("Access-Control-Allow-Origin", "*");
-    response->addHeader("Access-Control-Allow-Methods", "GET");
-    response->addHeader("Access-Control-Allow-Headers", "Content-Type");
-    request->send(response);
+    if (request->hasParam("since")) {
+      unsigned long since = strtoul(request->getParam("since")->value().c_str(), NULL, 10);
+      // a since ahead of seq means we rebooted; answer at once so the client resyncs
+      if (since == measurement.get().seq) {
+        unsigned long timeout = LONGPOLL_TIMEOUT;
+        if (request->hasParam("timeout")) {
+          timeout = strtoul(request->getParam("timeout")->value().c_str(), NULL, 10);
+          if (timeout > LONGPOLL_TIMEOUT) timeout = LONGPOLL_TIMEOUT;
+        }
+        if (parkLongPoll(request, since, timeout)) return;
+        AsyncWebServerResponse *response = request->beginResponse(503, "text/plain", "too many waiting requests");
+        response->addHeader("Retry-After", String(config.get().timerDelay / 1000 + 1));
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        request->send(response);
+        return;
+      }
+    }
+    sendReadings(request);
   });
 
   server.on("/host", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String buf = "hostname: " + host;
+    String buf = "hostname: " + String(config.get().host);
     buf += ", ESP local MAC addr: " + String(WiFi.macAddress());
     log::toAll(buf);
     request->send(200, "text/plain", buf.c_str());
@@ -72,34 +149,82 @@ void startWebServer() {
     String response = "none";
     if (request->hasParam("hostname")) {
       Serial.printf("hostname %s", request->getParam("hostname")->value().c_str());
-      host = request->getParam("hostname")->value();
+      setHostname(request->getParam("hostname")->value());
+      String host = config.get().host;
       response = "change hostname to " + host;
       log::toAll(response);
       preferences.putString("hostname",host);
       log::toAll("preferences " + preferences.getString("hostname", "unknown") + "\n");
     } else if (request->hasParam("webtimer")) {
-      timerDelay = atoi(request->getParam("webtimer")->value().c_str());
+      int timerDelay = atoi(request->getParam("webtimer")->value().c_str());
       if (timerDelay < 0) timerDelay = DEFDELAY;
       if (timerDelay > 10000) timerDelay = 10000;
+      config.update([&](Config &c) { c.timerDelay = timerDelay; });
       response = "change web timer to " + String(timerDelay);
       log::toAll(response);
       preferences.putInt("timerdelay",timerDelay);
+    } else if (request->hasParam("fastdelay")) {
+      int fastDelay = atoi(request->getParam("fastdelay")->value().c_str());
+      if (fastDelay < MINFASTDELAY) fastDelay = MINFASTDELAY;
+      config.update([&](Config &c) { c.fastDelay = fastDelay; });
+      response = "change fast timer to " + String(fastDelay);
+      log::toAll(response);
+      preferences.putInt("fastdelay",fastDelay);
+    } else if (request->hasParam("stablewindow")) {
+      int stableWindow = atoi(request->getParam("stablewindow")->value().c_str());
+      if (stableWindow < 200) stableWindow = 200;
+      config.update([&](Config &c) { c.stableWindow = stableWindow; });
+      response = "change stability window to " + String(stableWindow);
+      log::toAll(response);
+      preferences.putInt("stablewin",stableWindow);
+    } else if (request->hasParam("stablespread")) {
+      int stableSpread = atoi(request->getParam("stablespread")->value().c_str());
+      config.update([&](Config &c) { c.stableSpread = stableSpread; });
+      response = "change stability spread to " + String(stableSpread);
+      log::toAll(response);
+      preferences.putInt("stablespread",stableSpread);
+    } else if (request->hasParam("stableslope")) {
+      int stableSlope = atoi(request->getParam("stableslope")->value().c_str());
+      config.update([&](Config &c) { c.stableSlope = stableSlope; });
+      response = "change stability slope to " + String(stableSlope);
+      log::toAll(response);
+      preferences.putInt("stableslope",stableSlope);
     } else if (request->hasParam("empty")) {
       configTare("empty");
-      response = "empty calibration successful, empty raw offset is " + String(empty_offset);
+      response = "calibrating empty, waiting for the load to settle; the new offset goes to the console log";
       log::toAll(response);
     } else if (request->hasParam("full")) {
       configTare("full");
-      response = "full calibration successful, full raw offset is " + String(full_raw);
+      response = "calibrating full, waiting for the load to settle; the new offset goes to the console log";
       log::toAll(response);
     }
     request->send(200, "text/plain", response.c_str());
     response = String();
   });
 
+  // Feed level history from the minute/hour/day rollups:
+  // /history?res=<seconds>&from=<epoch>&to=<epoch> picks the coarsest tier no finer than res
+  server.on("/history", HTTP_GET, [](AsyncWebServerRequest *request) {
+    uint32_t res = 60, from = 0, to = UINT32_MAX;
+    if (request->hasParam("res")) res = strtoul(request->getParam("res")->value().c_str(), NULL, 10);
+    if (request->hasParam("from")) from = strtoul(request->getParam("from")->value().c_str(), NULL, 10);
+    if (request->hasParam("to")) to = strtoul(request->getParam("to")->value().c_str(), NULL, 10);
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    rollupHistory(*response, res, from, to);
+    request->send(response);
+  });
+
+  // Noise characterization report (start a capture with the WebSerial "noise" command)
+  server.on("/noise", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", noiseReport());
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
   // Weight endpoint for feed weight monitoring
   server.on("/weight", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String loadcellStr = String(loadcell);
+    String loadcellStr = String(measurement.get().loadcell);
     log::toAll("Weight request: " + loadcellStr);
     request->send(200, "text/plain", loadcellStr);
     loadcellStr = String();
@@ -130,12 +255,11 @@ void startWebServer() {
         log::toAll("Browser timezone: " + timezone);
         log::toAll("Browser UTC offset (minutes): " + String(offset));
         
-        // Store the browser's timestamp (milliseconds since epoch)
-        updateTime = browserTimeData["timestamp"].as<unsigned long>();
-        log::toAll("Browser timestamp (ms): " + String(updateTime));
-        
-        // Initialize lastUpdate with the current browser time
-        lastUpdate = updateTime;
+        // Store the browser's clock (milliseconds since epoch) as an offset from uptime
+        int64_t timestamp = browserTimeData["timestamp"].as<int64_t>();
+        clockOffset = timestamp - esp_timer_get_time() / 1000;
+        log::toAll("Browser timestamp (ms): " + String((long long)timestamp));
+
         
         //preferences.putString("browserTimezone", timezone);
       } else {
@@ -144,14 +268,8 @@ void startWebServer() {
     }
   });
 
-  events.onConnect([](AsyncEventSourceClient *client){
-    if(client->lastId()){
-      Serial.printf("Client reconnected! Last message ID that it got is: %u\n", client->lastId());
-    }
-    // send event with message "hello!", id current millis
-    // and set reconnect delay to 1 second
-    client->send("hello!", NULL, millis(), 1000);
-  });
+  // hello, Last-Event-ID replay and client tracking (eventlog.cpp)
+  eventsBegin();
   server.addHandler(&events);
   server.addHandler(&ws);
   
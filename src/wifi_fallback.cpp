@@ -4,13 +4,24 @@
 
 #include "include.h"
 
-bool setupWifi() {
-  Serial.println("Starting WiFi (fallback mode)...");
-  
+// Start a connection attempt and return at once; network.cpp watches for the result
+// and calls this again (with backoff) to retry. Returns false if there is nothing to connect to.
+bool wifiBegin() {
   // Default credentials in case file can't be read
-  String ssid = "";
-  String password = "";
-  
+  static String ssid = "";
+  static String password = "";
+  static bool loaded = false;
+
+  if (loaded) {
+    if (ssid.length() == 0) return false;
+    Serial.println("Retrying WiFi " + ssid);
+    WiFi.disconnect();
+    WiFi.begin(ssid.c_str(), password.c_str());
+    return true;
+  }
+  loaded = true;
+  Serial.println("Starting WiFi (fallback mode)...");
+
   // Read WiFi credentials from JSON file
   if (SPIFFS.exists("/wifi.json")) {
     File configFile = SPIFFS.open("/wifi.json", "r");
@@ -37,36 +48,19 @@ bool setupWifi() {
   }
   
   if (ssid.length() == 0) {
-    Serial.println("No SSID configured, cannot connect to WiFi");
+    Serial.println("No SSID configured, cannot connect to WiFi. Please configure WiFi manually.");
+    Serial.println("Format of the wifi.json file to put in spiffs (/data):");
+    Serial.println("{\n\t\"ssid\": \"your_SSID\",\n\t\"password\": \"your_password\"\n}");
     return false;
   }
-  
-  // Set WiFi to station mode
+
+  // Set WiFi to station mode; reconnects are ours, with backoff
   WiFi.mode(WIFI_STA);
-  
+  WiFi.setAutoReconnect(false);
+
   // Try to connect to saved WiFi credentials
   WiFi.begin(ssid.c_str(), password.c_str());
-  
-  // Wait for connection with timeout
-  int timeout = 20;
-  while (WiFi.status() != WL_CONNECTED && timeout > 0) {
-    delay(500);
-    Serial.print(".");
-    timeout--;
-  }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("");
-    Serial.print("Connected to WiFi. IP address: ");
-    Serial.println(WiFi.localIP());
-    return true;
-  } else {
-    Serial.println("");
-    Serial.println("Failed to connect to WiFi. Please configure WiFi manually.");
-    Serial.println("Format of the wifi.json file to put in spiffs (/data):");
-    Serial.println("{\n\t\"ssid\": \"your_SSID\",\n\t\"password\": \"your_password\"\n}");
-    return false;
-  }
+  return true;
 }
 
 void resetWifi() {
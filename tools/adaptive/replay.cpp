@@ -0,0 +1,232 @@
+// Replays a raw HX711 trace through the firmware's adaptive report rate (src/adaptive.h)
+// and through the old fixed timerDelay schedule, and compares what each would have cost.
+//
+//   adaptive-replay [-b base_ms] [-f fast_ms] [-s slow_ms] [-t counts] [-e empty] [-F full]
+//                   [-c convert_us] [-x radio_ms] [-r sps] trace.csv
+//   adaptive-replay -g hours [-r sps] > trace.csv     synthetic trace
+//
+// The trace is lines of "ms,raw", or a /noise.csv capture (one raw value per line, the
+// header giving the duration; -r sets the rate when there is no header). The firmware loop
+// is simulated step by step:
+//   fixed     one event every base_ms (the old behaviour)
+//   adaptive  loop() looks at the latest conversion every AdaptiveRate::interval(), between
+//             fast_ms and slow_ms, and sends an event while active, when the level changes,
+//             or once per slow_ms
+// The firmware reads every HX711 conversion either way (sensorPoll() feeds the watchdog and
+// the stability window), so both pay convert_us per trace sample; only events differ, at
+// radio_ms each (serialize and transmit). Savings are therefore reported for events and
+// for total awake time, not for conversions. Tracking error is the mean and worst gap
+// between the last reported level and the trace's true level, sampled every 100 ms. Prints
+// a JSON report. The RATE pin switch to 80 SPS is not modelled.
+
+#include "../../src/adaptive.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <random>
+#include <vector>
+
+struct Sample {
+  uint32_t t;
+  int32_t raw;
+};
+
+struct Result {
+  unsigned long events = 0;
+  double errSum = 0, errMax = 0;
+  unsigned long errN = 0;
+};
+
+static long scale(long raw, long empty, long full) {
+  if (full == empty) return 0;
+  long level = (raw - empty) * 100 / (full - empty);
+  return level < 0 ? 0 : level > 100 ? 100 : level;
+}
+
+// latest trace sample at or before t (idx advances monotonically)
+static const Sample &at(const std::vector<Sample> &trace, size_t &idx, uint32_t t) {
+  while (idx + 1 < trace.size() && trace[idx + 1].t <= t) idx++;
+  return trace[idx];
+}
+
+// runs one schedule; next(t, raw, level, report) returns the delay to the next look
+template<typename F>
+static Result simulate(const std::vector<Sample> &trace, long empty, long full, F next) {
+  Result r;
+  uint32_t end = trace.back().t;
+  size_t idx = 0, truthIdx = 0;
+  long reported = -1;
+  uint32_t sampleAt = trace.front().t, checkAt = trace.front().t;
+  while (sampleAt <= end) {
+    // tracking error up to this sample
+    for (; checkAt < sampleAt; checkAt += 100) {
+      if (reported < 0) continue;
+      double err = fabs((double)scale(at(trace, truthIdx, checkAt).raw, empty, full) - reported);
+      r.errSum += err;
+      r.errN++;
+      if (err > r.errMax) r.errMax = err;
+    }
+    const Sample &s = at(trace, idx, sampleAt);
+    long level = scale(s.raw, empty, full);
+    bool report = false;
+    uint32_t delay = next(sampleAt, s.raw, level, report);
+    if (report) {
+      r.events++;
+      reported = level;
+    }
+    sampleAt += delay;
+  }
+  return r;
+}
+
+static void printResult(const char *name, const Result &r, double hours, double convertMs, double radioMs) {
+  printf("  \"%s\":{\"events\":%lu,\"events_per_hour\":%.1f,\"radio_ms\":%.0f,\"awake_ms\":%.0f,"
+         "\"err_mean\":%.2f,\"err_max\":%.0f},\n",
+         name, r.events, r.events / hours, r.events * radioMs, convertMs + r.events * radioMs,
+         r.errN ? r.errSum / r.errN : 0, r.errMax);
+}
+
+// synthetic feeder day, for checking the tool rather than the firmware: slow consumption,
+// hens knocking the feeder, a refill every 8 hours
+static void generate(double hours, double sps) {
+  std::mt19937 rng(42);
+  std::normal_distribution<double> noise(0, 300);
+  std::uniform_real_distribution<double> uni(0, 1);
+  const double empty = -50000, full = -450000;
+  double level = 0.9, swing = 0, phase = 0;
+  uint32_t n = (uint32_t)(hours * 3600 * sps);
+  for (uint32_t i = 0; i < n; i++) {
+    double t = i / sps;
+    level -= 0.000004 / sps * 10;  // about 35% a day
+    if (fmod(t, 8 * 3600) < 1.0 / sps && i > 0) level = 0.95;
+    if (level < 0) level = 0;
+    // a knock sets off a decaying 1.2 Hz swing every few minutes in daytime
+    if (uni(rng) < 1.0 / (240 * sps) && fmod(t, 86400) > 6 * 3600 && fmod(t, 86400) < 20 * 3600) swing = 20000;
+    swing *= exp(-1.0 / (4 * sps));
+    phase += 2 * M_PI * 1.2 / sps;
+    double raw = empty + (full - empty) * level + swing * sin(phase) + noise(rng);
+    printf("%lu,%ld\n", (unsigned long)(t * 1000), (long)raw);
+  }
+}
+
+static void usage() {
+  fprintf(stderr, "usage: adaptive-replay [-b base_ms] [-f fast_ms] [-s slow_ms] [-t counts] [-e empty] [-F full]\n"
+                  "                       [-c convert_us] [-x radio_ms] [-r sps] trace.csv\n"
+                  "       adaptive-replay -g hours [-r sps] > trace.csv\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  uint32_t base = 1000, fast = 200, slow = 10000;
+  int32_t threshold = 2000;
+  long empty = 0, full = 0;
+  bool haveCal = false;
+  double convertUs = 100, radioMs = 5, sps = 0, genHours = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:f:s:t:e:F:c:x:r:g:")) != -1) {
+    switch (opt) {
+      case 'b': base = atol(optarg); break;
+      case 'f': fast = atol(optarg); break;
+      case 's': slow = atol(optarg); break;
+      case 't': threshold = atol(optarg); break;
+      case 'e': empty = atol(optarg); haveCal = true; break;
+      case 'F': full = atol(optarg); haveCal = true; break;
+      case 'c': convertUs = atof(optarg); break;
+      case 'x': radioMs = atof(optarg); break;
+      case 'r': sps = atof(optarg); break;
+      case 'g': genHours = atof(optarg); break;
+      default: usage();
+    }
+  }
+  if (genHours > 0) {
+    generate(genHours, sps > 0 ? sps : 10);
+    return 0;
+  }
+  if (optind != argc - 1 || base == 0 || fast == 0) usage();
+
+  FILE *f = fopen(argv[optind], "r");
+  if (!f) {
+    perror(argv[optind]);
+    return 1;
+  }
+  std::vector<Sample> trace;
+  double seconds = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') {
+      const char *s = strstr(line, "seconds=");
+      if (s) seconds = atof(s + 8);
+      continue;
+    }
+    char *end;
+    char *comma = strchr(line, ',');
+    if (comma) {
+      long t = strtol(line, &end, 10);
+      long raw = strtol(comma + 1, &end, 10);
+      if (end != comma + 1) trace.push_back({(uint32_t)t, (int32_t)raw});
+    } else {
+      long raw = strtol(line, &end, 10);
+      if (end != line) trace.push_back({0, (int32_t)raw});
+    }
+  }
+  fclose(f);
+  if (trace.size() < 2) {
+    fprintf(stderr, "trace too short\n");
+    return 1;
+  }
+  // raw-only traces get evenly spaced times
+  if (trace.back().t == 0) {
+    double rate = sps > 0 ? sps : seconds > 0 ? (trace.size() - 1) / seconds : 0;
+    if (rate <= 0) {
+      fprintf(stderr, "raw-only trace needs a seconds= header or -r sps\n");
+      return 1;
+    }
+    for (size_t i = 0; i < trace.size(); i++) trace[i].t = (uint32_t)(i * 1000.0 / rate);
+  }
+  if (!haveCal) {
+    // no calibration given: the trace's own extremes span 0-100%
+    empty = full = trace[0].raw;
+    for (auto &s : trace) {
+      if (s.raw < empty) empty = s.raw;
+      if (s.raw > full) full = s.raw;
+    }
+  }
+  double hours = (trace.back().t - trace.front().t) / 3600000.0;
+
+  Result fixed = simulate(trace, empty, full, [&](uint32_t, int32_t, long, bool &report) {
+    report = true;
+    return base;
+  });
+
+  AdaptiveRate rate;
+  rate.limits(fast, slow);
+  rate.setThreshold(threshold);
+  uint32_t lastReport = 0;
+  long lastLevel = -1;
+  Result adaptive = simulate(trace, empty, full, [&](uint32_t t, int32_t raw, long level, bool &report) {
+    uint32_t interval = rate.sample(t, raw);
+    report = rate.active() || level != lastLevel || t - lastReport >= slow;
+    if (report) {
+      lastReport = t;
+      lastLevel = level;
+    }
+    return interval;
+  });
+
+  // every conversion is read under both schedules
+  double convertMs = trace.size() * convertUs / 1000.0;
+  printf("{\n  \"trace\":{\"file\":\"%s\",\"conversions\":%zu,\"hours\":%.2f},\n", argv[optind], trace.size(), hours);
+  printf("  \"model\":{\"base_ms\":%lu,\"fast_ms\":%lu,\"slow_ms\":%lu,\"threshold\":%ld,\"convert_us\":%.0f,"
+         "\"radio_ms\":%.1f,\"convert_ms\":%.0f},\n",
+         (unsigned long)base, (unsigned long)fast, (unsigned long)slow, (long)threshold, convertUs, radioMs, convertMs);
+  printResult("fixed", fixed, hours, convertMs, radioMs);
+  printResult("adaptive", adaptive, hours, convertMs, radioMs);
+  auto saving = [](double a, double b) { return b > 0 ? 100.0 * (1 - a / b) : 0; };
+  printf("  \"savings_pct\":{\"events\":%.1f,\"awake\":%.1f}\n}\n", saving(adaptive.events, fixed.events),
+         saving(convertMs + adaptive.events * radioMs, convertMs + fixed.events * radioMs));
+  return 0;
+}
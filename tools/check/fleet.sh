@@ -0,0 +1,53 @@
+#!/bin/sh
+# End-to-end check of the collector against standin nodes that drop their event streams
+# (-d) and restart (-k): every node's new_readings ids in the store must only go up, with
+# no duplicates, and every jump must be covered by a gap event received before it.
+#
+#   check/fleet.sh [bin_dir] [base_port]
+
+BIN=${1:-bin}
+PORT=${2:-9400}
+NODES=3
+TMP=$(mktemp -d)
+trap 'kill $STANDIN 2>/dev/null; rm -rf "$TMP"' EXIT
+
+"$BIN/standin" -n $NODES -p $PORT -i 50 -d 7 -k 45 -t 10 -r ../data 2>"$TMP/standin.log" &
+STANDIN=$!
+sleep 0.5
+
+STATICS=""
+i=0
+while [ $i -lt $NODES ]; do
+  STATICS="$STATICS -s 127.0.0.1:$((PORT + i))"
+  i=$((i + 1))
+done
+"$BIN/collector" run $STATICS -o "$TMP/fleet.csv" -t 8 || exit 1
+
+# store lines: recv_ms,node,id,event,data (data has commas of its own)
+awk -F, -v nodes=$NODES '
+  $4 == "gap" {
+    match($0, /"from":[0-9]+/); from = substr($0, RSTART + 7, RLENGTH - 7) + 0
+    match($0, /"to":[0-9]+/); to = substr($0, RSTART + 5, RLENGTH - 5) + 0
+    gapFrom[$2] = from; gapTo[$2] = to; haveGap[$2] = 1; gaps++
+    next
+  }
+  $4 != "new_readings" { next }
+  {
+    id = $3 + 0; events++
+    if ($2 in last) {
+      if (id <= last[$2]) { printf "%s: id %d after %d (duplicate or out of order)\n", $2, id, last[$2]; bad++ }
+      else if (id != last[$2] + 1) {
+        if (!haveGap[$2] || gapFrom[$2] > last[$2] + 1 || gapTo[$2] < id - 1) {
+          printf "%s: ids %d-%d missing without a gap event\n", $2, last[$2] + 1, id - 1; bad++
+        }
+      }
+    }
+    last[$2] = id; haveGap[$2] = 0
+  }
+  END {
+    n = 0; for (k in last) n++
+    printf "fleet: %d nodes, %d events, %d gaps, %d errors\n", n, events, gaps, bad
+    if (n != nodes || events == 0) { print "fleet: not every node delivered events"; exit 1 }
+    if (gaps == 0) { print "fleet: no restart gap seen"; exit 1 }
+    exit bad ? 1 : 0
+  }' "$TMP/fleet.csv"
@@ -0,0 +1,110 @@
+#ifndef TOOLS_HTTP_H
+#define TOOLS_HTTP_H
+
+// Minimal HTTP/1.1 and Server-Sent Events parsing for the host-side tools.
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+// status code from the head of a response ("HTTP/1.1 200 OK\r\n..."), 0 if malformed
+inline int httpStatus(const std::string &head) {
+  if (head.compare(0, 5, "HTTP/") != 0) return 0;
+  size_t sp = head.find(' ');
+  if (sp == std::string::npos) return 0;
+  return atoi(head.c_str() + sp + 1);
+}
+
+// value of header name in a request or response head, "" if absent (case-insensitive name)
+inline std::string httpHeader(const std::string &head, const char *name) {
+  size_t len = strlen(name);
+  size_t pos = head.find("\r\n");
+  while (pos != std::string::npos && pos + 2 < head.size()) {
+    size_t start = pos + 2;
+    size_t end = head.find("\r\n", start);
+    if (end == std::string::npos) end = head.size();
+    if (end - start > len && head[start + len] == ':' && strncasecmp(head.c_str() + start, name, len) == 0) {
+      size_t v = start + len + 1;
+      while (v < end && head[v] == ' ') v++;
+      return head.substr(v, end - v);
+    }
+    pos = end;
+  }
+  return "";
+}
+
+// one dispatched event; event is "message" when the stream gave no event name
+struct SseEvent {
+  std::string id, event, data;
+};
+
+// Incremental text/event-stream parser: feed() bytes as they arrive and each complete
+// event is passed to the callback. lastId and retry follow the spec's id:/retry: fields.
+class SseParser {
+public:
+  std::string lastId;
+  long retry = 0;
+
+  template<typename F>
+  void feed(const char *p, size_t n, F f) {
+    for (size_t i = 0; i < n; i++) {
+      char c = p[i];
+      if (c == '\n') {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        processLine(f);
+        line.clear();
+      } else {
+        line += c;
+      }
+    }
+  }
+
+  void reset() {
+    line.clear();
+    cur = SseEvent();
+    hasData = false;
+  }
+
+private:
+  std::string line;
+  SseEvent cur;
+  bool hasData = false;
+
+  template<typename F>
+  void processLine(F &f) {
+    if (line.empty()) {
+      // blank line dispatches the event built so far
+      if (hasData) {
+        if (cur.event.empty()) cur.event = "message";
+        cur.id = lastId;
+        f(cur);
+      }
+      cur = SseEvent();
+      hasData = false;
+      return;
+    }
+    if (line[0] == ':') return;  // comment
+    size_t colon = line.find(':');
+    std::string field = line.substr(0, colon);
+    std::string value;
+    if (colon != std::string::npos) {
+      value = line.substr(colon + 1);
+      if (!value.empty() && value[0] == ' ') value.erase(0, 1);
+    }
+    if (field == "data") {
+      if (hasData) cur.data += '\n';
+      cur.data += value;
+      hasData = true;
+    } else if (field == "event") {
+      cur.event = value;
+    } else if (field == "id") {
+      lastId = value;
+    } else if (field == "retry") {
+      retry = atol(value.c_str());
+    }
+  }
+};
+
+#endif
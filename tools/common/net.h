@@ -0,0 +1,150 @@
+#ifndef TOOLS_NET_H
+#define TOOLS_NET_H
+
+// Small helpers shared by the host-side tools: clocks, non-blocking sockets and epoll.
+// Linux only.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+// monotonic msecs, for timeouts and backoff
+inline int64_t monoMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// monotonic usecs, for latency measurements
+inline int64_t monoUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// wall-clock msecs since the epoch, for stored timestamps
+inline int64_t wallMs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// "host[:port]" -> IPv4 address; blocking DNS lookup, only used at startup
+inline bool resolve(const std::string &spec, int defPort, sockaddr_in &addr, std::string &host) {
+  host = spec;
+  int port = defPort;
+  size_t colon = spec.rfind(':');
+  if (colon != std::string::npos) {
+    host = spec.substr(0, colon);
+    port = atoi(spec.c_str() + colon + 1);
+  }
+  addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+  addr = *(sockaddr_in *)res->ai_addr;
+  addr.sin_port = htons(port);
+  freeaddrinfo(res);
+  return true;
+}
+
+inline std::string addrString(const sockaddr_in &addr) {
+  char buf[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &addr.sin_addr, buf, sizeof(buf));
+  return std::string(buf) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+// start a non-blocking connect; returns the fd or -1
+inline int connectNonBlocking(const sockaddr_in &addr) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(fd, (const sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// non-blocking listening socket on addr; returns the fd or -1
+inline int listenNonBlocking(const sockaddr_in &addr, int backlog = 512) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(fd, (const sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// pending error of a socket whose non-blocking connect has completed
+inline int socketError(int fd) {
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) return errno;
+  return err;
+}
+
+// epoll registration with the caller's pointer as the cookie
+inline bool epollAdd(int ep, int fd, uint32_t events, void *ptr) {
+  epoll_event ev = {};
+  ev.events = events;
+  ev.data.ptr = ptr;
+  return epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+inline bool epollMod(int ep, int fd, uint32_t events, void *ptr) {
+  epoll_event ev = {};
+  ev.events = events;
+  ev.data.ptr = ptr;
+  return epoll_ctl(ep, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+// write as much of out (from off) as the socket takes; false on a hard error
+inline bool flushOut(int fd, std::string &out, size_t &off) {
+  while (off < out.size()) {
+    ssize_t n = send(fd, out.data() + off, out.size() - off, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      if (errno == EINTR) continue;
+      return false;
+    }
+    off += n;
+  }
+  out.clear();
+  off = 0;
+  return true;
+}
+
+// append everything readable to in; false when the peer closed or on a hard error
+inline bool readAll(int fd, std::string &in) {
+  char buf[4096];
+  for (;;) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      in.append(buf, n);
+      continue;
+    }
+    if (n == 0) return false;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+    if (errno == EINTR) continue;
+    return false;
+  }
+}
+
+#endif
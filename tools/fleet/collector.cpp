@@ -0,0 +1,503 @@
+// Fleet collector for coop feeder nodes.
+//
+// Discovers nodes over mDNS (_http._tcp, hostnames starting with a prefix) and/or takes a
+// static list, keeps one /events subscription per node on a single epoll loop, reconnects
+// with exponential backoff and Last-Event-ID, and appends every event to one store file.
+// All sockets are serviced by one thread, so events are appended in receive order and the
+// store is time-ordered by construction.
+//
+//   collector run   [-s host[:port]]... [-l list] [-m prefix] [-o store.csv] [-t seconds] [-v]
+//   collector query [-o store.csv] [-n node] [-e event] [-f from_ms] [-u until_ms]
+//
+// -l reads a static list with one host[:port] per line.
+// Store format, one event per line: recv_ms,node,id,event,data
+
+#include "../common/http.h"
+#include "../common/net.h"
+
+#include <signal.h>
+#include <stdarg.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#define DEFAULT_PORT 80
+#define BACKOFF_MIN 1000       // msecs before the first reconnect
+#define BACKOFF_MAX 60000      // cap on exponential backoff
+#define IDLE_TIMEOUT 90000     // reconnect when a stream is silent this long
+#define CONNECT_TIMEOUT 10000
+#define MDNS_INTERVAL 60000    // re-query mDNS for new nodes
+#define TIMER_TICK 250         // msecs between backoff/timeout scans
+
+static bool verbose = false;
+static volatile sig_atomic_t stopping = 0;
+
+static void logf(const char *fmt, ...) {
+  if (!verbose) return;
+  va_list ap;
+  va_start(ap, fmt);
+  fprintf(stderr, "[%lld] ", (long long)wallMs());
+  vfprintf(stderr, fmt, ap);
+  fputc('\n', stderr);
+  va_end(ap);
+}
+
+// ---- store ----
+
+class Store {
+public:
+  bool open(const std::string &path) {
+    f = fopen(path.c_str(), "a");
+    return f != nullptr;
+  }
+  ~Store() { if (f) fclose(f); }
+
+  void append(int64_t ms, const std::string &node, const SseEvent &ev) {
+    // data is last so it may contain commas; newlines are folded to keep one event per line
+    std::string data = ev.data;
+    std::replace(data.begin(), data.end(), '\n', ' ');
+    fprintf(f, "%lld,%s,%s,%s,%s\n", (long long)ms, node.c_str(), ev.id.c_str(), ev.event.c_str(), data.c_str());
+    count++;
+  }
+  void flush() { if (f) fflush(f); }
+
+  uint64_t count = 0;
+
+private:
+  FILE *f = nullptr;
+};
+
+// ---- one SSE subscription ----
+
+struct Node {
+  enum State { IDLE, CONNECTING, HEADERS, STREAM };
+
+  std::string name;
+  sockaddr_in addr;
+  int fd = -1;
+  State state = IDLE;
+  std::string in, out;
+  size_t outOff = 0;
+  SseParser sse;
+  int64_t backoff = 0;       // msecs; 0 until the first failure
+  int64_t nextAttempt = 0;   // monotonic msecs
+  int64_t lastActivity = 0;
+  uint64_t events = 0, connects = 0;
+};
+
+class Collector {
+public:
+  explicit Collector(Store &store) : store(store), rng(std::random_device{}()) {
+    ep = epoll_create1(EPOLL_CLOEXEC);
+  }
+
+  // add a node unless one with the same address exists; returns true when added
+  bool addNode(const std::string &name, const sockaddr_in &addr) {
+    std::string key = addrString(addr);
+    if (byAddr.count(key)) return false;
+    nodes.emplace_back(new Node());
+    Node *n = nodes.back().get();
+    n->name = name;
+    n->addr = addr;
+    byAddr[key] = n;
+    logf("node %s (%s)", name.c_str(), key.c_str());
+    return true;
+  }
+
+  int epollFd() const { return ep; }
+  size_t size() const { return nodes.size(); }
+
+  // start connections whose backoff has expired and drop stalled ones
+  void tick(int64_t now) {
+    for (auto &p : nodes) {
+      Node *n = p.get();
+      if (n->state == Node::IDLE && now >= n->nextAttempt) {
+        connectNode(n, now);
+      } else if (n->state == Node::CONNECTING || n->state == Node::HEADERS) {
+        if (now - n->lastActivity > CONNECT_TIMEOUT) fail(n, now, "connect timeout");
+      } else if (n->state == Node::STREAM && now - n->lastActivity > IDLE_TIMEOUT) {
+        fail(n, now, "idle timeout");
+      }
+    }
+  }
+
+  void onEvent(Node *n, uint32_t events, int64_t now) {
+    if (n->state == Node::CONNECTING && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+      int err = socketError(n->fd);
+      if (err) {
+        fail(n, now, strerror(err));
+        return;
+      }
+      n->state = Node::HEADERS;
+      n->lastActivity = now;
+      sendRequest(n);
+      epollMod(ep, n->fd, EPOLLIN | EPOLLRDHUP, n);
+    }
+    if (n->out.size()) {
+      if (!flushOut(n->fd, n->out, n->outOff)) {
+        fail(n, now, "write failed");
+        return;
+      }
+      epollMod(ep, n->fd, EPOLLIN | EPOLLRDHUP | (n->out.size() ? (uint32_t)EPOLLOUT : 0), n);
+    }
+    if (events & EPOLLIN) {
+      size_t before = n->in.size();
+      bool open = readAll(n->fd, n->in);
+      if (n->in.size() > before) {
+        n->lastActivity = now;
+        if (!process(n, now)) return;
+      }
+      if (!open) fail(n, now, "closed by peer");
+    } else if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+      fail(n, now, "connection error");
+    }
+  }
+
+  void summary(FILE *out) const {
+    size_t streaming = 0;
+    uint64_t connects = 0;
+    for (auto &p : nodes) {
+      if (p->state == Node::STREAM) streaming++;
+      connects += p->connects;
+    }
+    fprintf(out, "nodes %zu streaming %zu events %llu connects %llu\n", nodes.size(), streaming,
+            (unsigned long long)store.count, (unsigned long long)connects);
+  }
+
+private:
+  Store &store;
+  int ep;
+  std::vector<std::unique_ptr<Node>> nodes;
+  std::map<std::string, Node *> byAddr;
+  std::mt19937 rng;
+
+  void connectNode(Node *n, int64_t now) {
+    n->fd = connectNonBlocking(n->addr);
+    if (n->fd < 0) {
+      fail(n, now, strerror(errno));
+      return;
+    }
+    n->state = Node::CONNECTING;
+    n->lastActivity = now;
+    n->in.clear();
+    n->out.clear();
+    n->outOff = 0;
+    n->connects++;
+    epollAdd(ep, n->fd, EPOLLOUT | EPOLLRDHUP, n);
+  }
+
+  void sendRequest(Node *n) {
+    n->out = "GET /events HTTP/1.1\r\nHost: " + n->name + "\r\nAccept: text/event-stream\r\nCache-Control: no-cache\r\n";
+    // resume after the last event we stored; the node replays what it still has
+    if (!n->sse.lastId.empty()) n->out += "Last-Event-ID: " + n->sse.lastId + "\r\n";
+    n->out += "\r\n";
+    n->outOff = 0;
+  }
+
+  // parse response headers, then feed the stream; false if the node was failed
+  bool process(Node *n, int64_t now) {
+    if (n->state == Node::HEADERS) {
+      size_t end = n->in.find("\r\n\r\n");
+      if (end == std::string::npos) return true;
+      std::string head = n->in.substr(0, end);
+      int status = httpStatus(head);
+      if (status != 200 || httpHeader(head, "Content-Type").find("text/event-stream") == std::string::npos) {
+        fail(n, now, ("bad response " + std::to_string(status)).c_str());
+        return false;
+      }
+      n->in.erase(0, end + 4);
+      n->state = Node::STREAM;
+      n->sse.reset();
+      logf("%s streaming", n->name.c_str());
+    }
+    n->sse.feed(n->in.data(), n->in.size(), [&](const SseEvent &ev) {
+      store.append(wallMs(), n->name, ev);
+      n->events++;
+      // a delivered event means the node is healthy again
+      n->backoff = 0;
+    });
+    n->in.clear();
+    return true;
+  }
+
+  // close and schedule a reconnect with jittered exponential backoff
+  void fail(Node *n, int64_t now, const char *why) {
+    if (n->fd >= 0) {
+      epoll_ctl(ep, EPOLL_CTL_DEL, n->fd, nullptr);
+      close(n->fd);
+      n->fd = -1;
+    }
+    n->state = Node::IDLE;
+    int64_t base = std::max<int64_t>(BACKOFF_MIN, n->sse.retry);
+    n->backoff = n->backoff ? std::min<int64_t>(n->backoff * 2, BACKOFF_MAX) : base;
+    std::uniform_int_distribution<int64_t> jitter(0, n->backoff / 4);
+    n->nextAttempt = now + n->backoff + jitter(rng);
+    logf("%s: %s, retry in %lld ms", n->name.c_str(), why, (long long)(n->nextAttempt - now));
+  }
+};
+
+// ---- mDNS discovery ----
+
+// One-shot unicast-response mDNS queries for _http._tcp.local; answers arrive on the
+// same socket and are handled in the main epoll loop.
+class Mdns {
+public:
+  explicit Mdns(const std::string &prefix) : prefix(prefix) {
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  }
+  ~Mdns() { if (fd >= 0) close(fd); }
+
+  int fd;
+
+  void query() {
+    static const char name[] = "\x05_http\x04_tcp\x05local";
+    uint8_t pkt[64] = {0};
+    pkt[5] = 1;  // qdcount
+    size_t len = 12;
+    memcpy(pkt + len, name, sizeof(name));  // includes the terminating root label
+    len += sizeof(name);
+    pkt[len++] = 0; pkt[len++] = 12;        // PTR
+    pkt[len++] = 0x80; pkt[len++] = 1;      // IN, unicast response requested
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(5353);
+    inet_pton(AF_INET, "224.0.0.251", &to.sin_addr);
+    sendto(fd, pkt, len, 0, (sockaddr *)&to, sizeof(to));
+  }
+
+  // parse answers; calls found(hostname, addr) for every matching SRV target with an A record
+  template<typename F>
+  void onReadable(F found) {
+    uint8_t buf[4096];
+    for (;;) {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) return;
+      parse(buf, n, found);
+    }
+  }
+
+private:
+  std::string prefix;
+
+  // DNS name at off with compression pointers; off is advanced past the name in place
+  static bool readName(const uint8_t *p, size_t len, size_t &off, std::string &out) {
+    out.clear();
+    size_t pos = off;
+    bool jumped = false;
+    for (int hops = 0; hops < 32; hops++) {
+      if (pos >= len) return false;
+      uint8_t l = p[pos];
+      if (l == 0) {
+        if (!jumped) off = pos + 1;
+        return true;
+      }
+      if ((l & 0xC0) == 0xC0) {
+        if (pos + 1 >= len) return false;
+        if (!jumped) off = pos + 2;
+        pos = ((l & 0x3F) << 8) | p[pos + 1];
+        jumped = true;
+        continue;
+      }
+      if (pos + 1 + l > len) return false;
+      if (!out.empty()) out += '.';
+      out.append((const char *)p + pos + 1, l);
+      pos += 1 + l;
+    }
+    return false;
+  }
+
+  template<typename F>
+  void parse(const uint8_t *p, size_t len, F &found) {
+    if (len < 12) return;
+    int qd = (p[4] << 8) | p[5];
+    int rr = ((p[6] << 8) | p[7]) + ((p[8] << 8) | p[9]) + ((p[10] << 8) | p[11]);
+    size_t off = 12;
+    std::string name;
+    for (int i = 0; i < qd; i++) {
+      if (!readName(p, len, off, name)) return;
+      off += 4;
+    }
+    std::map<std::string, std::pair<std::string, int>> srv;  // instance -> target, port
+    std::map<std::string, in_addr> a;                        // host -> address
+    for (int i = 0; i < rr; i++) {
+      if (!readName(p, len, off, name) || off + 10 > len) return;
+      int type = (p[off] << 8) | p[off + 1];
+      int rdlen = (p[off + 8] << 8) | p[off + 9];
+      off += 10;
+      if (off + rdlen > len) return;
+      if (type == 33 && rdlen > 6) {  // SRV: priority, weight, port, target
+        size_t t = off + 6;
+        std::string target;
+        if (readName(p, len, t, target)) srv[name] = {target, (p[off + 4] << 8) | p[off + 5]};
+      } else if (type == 1 && rdlen == 4) {  // A
+        in_addr ip;
+        memcpy(&ip, p + off, 4);
+        a[name] = ip;
+      }
+      off += rdlen;
+    }
+    for (auto &s : srv) {
+      const std::string &target = s.second.first;
+      if (target.compare(0, prefix.size(), prefix) != 0 || !a.count(target)) continue;
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr = a[target];
+      addr.sin_port = htons(s.second.second);
+      found(target, addr);
+    }
+  }
+};
+
+// ---- commands ----
+
+static void onSignal(int) { stopping = 1; }
+
+static int run(int argc, char **argv) {
+  std::vector<std::string> statics;
+  std::string prefix, storePath = "fleet.csv";
+  bool useMdns = false;
+  int seconds = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:l:m:o:t:v")) != -1) {
+    switch (opt) {
+      case 's': statics.push_back(optarg); break;
+      case 'l': {
+        FILE *f = fopen(optarg, "r");
+        if (!f) {
+          perror(optarg);
+          return 1;
+        }
+        char buf[256];
+        while (fgets(buf, sizeof(buf), f)) {
+          buf[strcspn(buf, " \t\r\n#")] = 0;
+          if (buf[0]) statics.push_back(buf);
+        }
+        fclose(f);
+        break;
+      }
+      case 'm': useMdns = true; prefix = optarg; break;
+      case 'o': storePath = optarg; break;
+      case 't': seconds = atoi(optarg); break;
+      case 'v': verbose = true; break;
+      default: return 2;
+    }
+  }
+  if (statics.empty() && !useMdns) {
+    fprintf(stderr, "collector run: give -s host[:port], -l list and/or -m <mdns hostname prefix>\n");
+    return 2;
+  }
+  Store store;
+  if (!store.open(storePath)) {
+    perror(storePath.c_str());
+    return 1;
+  }
+  Collector collector(store);
+  for (auto &spec : statics) {
+    sockaddr_in addr;
+    std::string host;
+    if (!resolve(spec, DEFAULT_PORT, addr, host)) {
+      fprintf(stderr, "cannot resolve %s\n", spec.c_str());
+      continue;
+    }
+    collector.addNode(spec, addr);
+  }
+  std::unique_ptr<Mdns> mdns;
+  if (useMdns) {
+    mdns.reset(new Mdns(prefix));
+    epollAdd(collector.epollFd(), mdns->fd, EPOLLIN, mdns.get());
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+  int64_t start = monoMs(), nextTick = 0, nextQuery = 0, nextFlush = start + 1000;
+  std::vector<epoll_event> events(256);
+  while (!stopping && (!seconds || monoMs() - start < seconds * 1000LL)) {
+    int64_t now = monoMs();
+    if (now >= nextTick) {
+      collector.tick(now);
+      nextTick = now + TIMER_TICK;
+    }
+    if (mdns && now >= nextQuery) {
+      mdns->query();
+      nextQuery = now + MDNS_INTERVAL;
+    }
+    if (now >= nextFlush) {
+      store.flush();
+      nextFlush = now + 1000;
+    }
+    int n = epoll_wait(collector.epollFd(), events.data(), events.size(), (int)std::max<int64_t>(1, nextTick - now));
+    now = monoMs();
+    for (int i = 0; i < n; i++) {
+      if (mdns && events[i].data.ptr == mdns.get()) {
+        mdns->onReadable([&](const std::string &host, const sockaddr_in &addr) {
+          collector.addNode(host, addr);
+        });
+      } else {
+        collector.onEvent((Node *)events[i].data.ptr, events[i].events, now);
+      }
+    }
+  }
+  store.flush();
+  collector.summary(stdout);
+  return 0;
+}
+
+static int query(int argc, char **argv) {
+  std::string storePath = "fleet.csv", node, event;
+  long long from = 0, until = INT64_MAX;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:n:e:f:u:")) != -1) {
+    switch (opt) {
+      case 'o': storePath = optarg; break;
+      case 'n': node = optarg; break;
+      case 'e': event = optarg; break;
+      case 'f': from = atoll(optarg); break;
+      case 'u': until = atoll(optarg); break;
+      default: return 2;
+    }
+  }
+  FILE *f = fopen(storePath.c_str(), "r");
+  if (!f) {
+    perror(storePath.c_str());
+    return 1;
+  }
+  char *line = nullptr;
+  size_t cap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &cap, f)) > 0) {
+    long long ms = atoll(line);
+    if (ms < from) continue;
+    // the store is time-ordered, so nothing later can match
+    if (ms >= until) break;
+    char *nodeField = strchr(line, ',');
+    if (!nodeField) continue;
+    nodeField++;
+    char *idField = strchr(nodeField, ',');
+    if (!idField) continue;
+    if (!node.empty() && node.compare(0, std::string::npos, nodeField, idField - nodeField) != 0) continue;
+    char *eventField = strchr(idField + 1, ',');
+    if (!eventField) continue;
+    char *dataField = strchr(eventField + 1, ',');
+    if (!dataField) continue;
+    if (!event.empty() && event.compare(0, std::string::npos, eventField + 1, dataField - eventField - 1) != 0) continue;
+    fputs(line, stdout);
+  }
+  free(line);
+  fclose(f);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || (strcmp(argv[1], "run") && strcmp(argv[1], "query"))) {
+    fprintf(stderr,
+            "usage: collector run   [-s host[:port]]... [-l list] [-m prefix] [-o store.csv] [-t seconds] [-v]\n"
+            "       collector query [-o store.csv] [-n node] [-e event] [-f from_ms] [-u until_ms]\n");
+    return 2;
+  }
+  // getopt starts after the command word
+  return strcmp(argv[1], "run") == 0 ? run(argc - 1, argv + 1) : query(argc - 1, argv + 1);
+}
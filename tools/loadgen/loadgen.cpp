@@ -0,0 +1,436 @@
+// Load generator and latency benchmark for the feeder's web endpoints.
+//
+// Drives a weighted mix of short requests from a fixed number of concurrent clients
+// (closed loop, one request per connection like the dashboards and pollers do), plus a
+// number of long-lived /events subscribers, against a real node or tools/bin/standin.
+// Reports per-endpoint throughput, error counts and p50/p99/p999 latency, and SSE delivery
+// lag, as JSON.
+//
+//   loadgen -u host[:port] [-c clients] [-m mix] [-e sse_clients] [-w think_ms] [-R] [-C]
+//           [-B endpoint]
+//           [-d seconds] [-T timeout_ms] [-l label] [-o report.json]
+//
+// mix is a comma-separated list of endpoint=weight; endpoints are
+//   index (/), static (/style.css, /script.js, /gauge.min.js), readings, longpoll
+//   (/readings?since=<last seq>), weight, config (/config, no parameters)
+// default: index=5,static=10,readings=60,weight=20,config=5
+//
+// A client answered 503 waits as long as its Retry-After (in seconds) asks, like a polite
+// poller; -R ignores it and retries after think_ms, to see how the node copes with clients
+// that don't back off.
+//
+// SSE lag is measured per event id as the delay after the first subscriber received it
+// (fan-out lag, needs no clock sync), and against the event's lastUpdate when that is a
+// plausible wall-clock time. The stand-in always stamps wall-clock time; a real node does
+// once a browser has posted /browsertime, and -C makes loadgen post this host's clock
+// first so the lag is measured against the same clock it is read with.
+//
+// Exits 1 if any request failed (connection error, timeout or a status other than 2xx and
+// 503), or if -B names an endpoint that never got a 503, i.e. the node's admission limit
+// was expected to kick in and did not.
+
+#include "../common/http.h"
+#include "../common/net.h"
+
+#include <signal.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#define DEFAULT_PORT 80
+#define LONGPOLL_EXTRA 35000  // longpoll requests may legitimately wait LONGPOLL_TIMEOUT
+
+static volatile sig_atomic_t stopping = 0;
+static void onSignal(int) { stopping = 1; }
+
+// ---- statistics ----
+
+struct Samples {
+  std::vector<int64_t> us;
+
+  void add(int64_t v) { us.push_back(v); }
+  // nearest-rank percentile in msecs
+  double pct(double p) {
+    if (us.empty()) return 0;
+    std::sort(us.begin(), us.end());
+    size_t i = (size_t)(p / 100.0 * (us.size() - 1) + 0.5);
+    return us[i] / 1000.0;
+  }
+  double max() { return us.empty() ? 0 : *std::max_element(us.begin(), us.end()) / 1000.0; }
+};
+
+struct EndpointStats {
+  uint64_t requests = 0, ok = 0, errors = 0, timeouts = 0, busy = 0;  // busy: 503
+  std::map<int, uint64_t> status;
+  Samples latency;
+};
+
+// ---- endpoints and mix ----
+
+enum Endpoint { INDEX, STATIC, READINGS, LONGPOLL, WEIGHT, CONFIG, ENDPOINTS };
+static const char *endpointNames[ENDPOINTS] = {"index", "static", "readings", "longpoll", "weight", "config"};
+static const char *staticFiles[] = {"/style.css", "/script.js", "/gauge.min.js"};
+
+static bool parseMix(const std::string &spec, std::vector<int> &weights) {
+  weights.assign(ENDPOINTS, 0);
+  size_t pos = 0;
+  while (pos < spec.size()) {
+    size_t comma = spec.find(',', pos);
+    std::string item = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+    size_t eq = item.find('=');
+    std::string name = item.substr(0, eq);
+    int w = eq == std::string::npos ? 1 : atoi(item.c_str() + eq + 1);
+    int e = std::find_if(endpointNames, endpointNames + ENDPOINTS, [&](const char *n) { return name == n; }) - endpointNames;
+    if (e == ENDPOINTS) {
+      fprintf(stderr, "unknown endpoint in mix: %s\n", name.c_str());
+      return false;
+    }
+    weights[e] = w;
+    if (comma == std::string::npos) break;
+    pos = comma + 1;
+  }
+  return true;
+}
+
+// ---- connections ----
+
+struct Client {
+  bool sse = false;
+  int fd = -1;
+  Endpoint endpoint = READINGS;
+  std::string in, out;
+  size_t outOff = 0;
+  int64_t startUs = 0, deadline = 0, nextStart = 0;
+  bool connected = false;
+  // sse subscribers
+  SseParser parser;
+  bool streaming = false;
+};
+
+class LoadGen {
+public:
+  LoadGen(const sockaddr_in &addr, const std::string &host, const std::vector<int> &weights, int think, int timeout,
+          bool retryAfter)
+    : addr(addr), host(host), weights(weights.begin(), weights.end()), think(think), timeout(timeout),
+      retryAfter(retryAfter),
+      rng(std::random_device{}()) {
+    ep = epoll_create1(EPOLL_CLOEXEC);
+  }
+
+  void addClients(int requesters, int subscribers) {
+    for (int i = 0; i < requesters; i++) clients.emplace_back(new Client());
+    for (int i = 0; i < subscribers; i++) {
+      clients.emplace_back(new Client());
+      clients.back()->sse = true;
+    }
+  }
+
+  // start due requests and enforce timeouts
+  void tick(int64_t nowUs) {
+    for (auto &p : clients) {
+      Client *c = p.get();
+      if (c->fd < 0 && nowUs >= c->nextStart) start(c, nowUs);
+      else if (c->fd >= 0 && !c->streaming && nowUs > c->deadline) finish(c, nowUs, -1);
+    }
+  }
+
+  void onEvent(Client *c, uint32_t events, int64_t nowUs) {
+    if (c->fd < 0) return;
+    if (!c->connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+      if (socketError(c->fd)) {
+        finish(c, nowUs, 0);
+        return;
+      }
+      c->connected = true;
+    }
+    if (c->out.size()) {
+      if (!flushOut(c->fd, c->out, c->outOff)) {
+        finish(c, nowUs, 0);
+        return;
+      }
+      epollMod(ep, c->fd, EPOLLIN | EPOLLRDHUP | (c->out.size() ? (uint32_t)EPOLLOUT : 0), c);
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      bool open = readAll(c->fd, c->in);
+      if (c->sse) sseData(c, nowUs);
+      else response(c, nowUs, open);
+      if (!open && c->fd >= 0) finish(c, nowUs, 0);
+    }
+  }
+
+  int epollFd() const { return ep; }
+
+  // pass/fail as documented at the top; reasons go to stderr
+  bool passed(int expectBusy) {
+    bool ok = true;
+    for (int e = 0; e < ENDPOINTS; e++) {
+      EndpointStats &s = stats[e];
+      if (s.errors || s.timeouts) {
+        fprintf(stderr, "loadgen: %s: %llu errors, %llu timeouts\n", endpointNames[e], (unsigned long long)s.errors,
+                (unsigned long long)s.timeouts);
+        ok = false;
+      }
+    }
+    if (expectBusy >= 0 && !stats[expectBusy].busy) {
+      fprintf(stderr, "loadgen: %s: no 503 in %llu requests\n", endpointNames[expectBusy],
+              (unsigned long long)stats[expectBusy].requests);
+      ok = false;
+    }
+    return ok;
+  }
+
+  void report(FILE *out, const std::string &label, double seconds) {
+    fprintf(out, "{\n  \"label\": \"%s\",\n  \"target\": \"%s\",\n  \"duration_s\": %.3f,\n", label.c_str(),
+            addrString(addr).c_str(), seconds);
+    fprintf(out, "  \"endpoints\": {");
+    bool first = true;
+    for (int e = 0; e < ENDPOINTS; e++) {
+      EndpointStats &s = stats[e];
+      if (!s.requests) continue;
+      fprintf(out, "%s\n    \"%s\": {\"requests\": %llu, \"ok\": %llu, \"errors\": %llu, \"timeouts\": %llu, \"busy_503\": %llu, "
+              "\"rps\": %.2f, \"p50_ms\": %.3f, \"p99_ms\": %.3f, \"p999_ms\": %.3f, \"max_ms\": %.3f, \"status\": {",
+              first ? "" : ",", endpointNames[e], (unsigned long long)s.requests, (unsigned long long)s.ok,
+              (unsigned long long)s.errors, (unsigned long long)s.timeouts, (unsigned long long)s.busy,
+              s.requests / seconds, s.latency.pct(50), s.latency.pct(99), s.latency.pct(99.9), s.latency.max());
+      bool firstStatus = true;
+      for (auto &st : s.status) {
+        fprintf(out, "%s\"%d\": %llu", firstStatus ? "" : ", ", st.first, (unsigned long long)st.second);
+        firstStatus = false;
+      }
+      fprintf(out, "}}");
+      first = false;
+    }
+    fprintf(out, "\n  },\n");
+    size_t subscribers = 0, streaming = 0;
+    for (auto &p : clients) {
+      if (!p->sse) continue;
+      subscribers++;
+      if (p->streaming) streaming++;
+    }
+    fprintf(out, "  \"sse\": {\"clients\": %zu, \"streaming\": %zu, \"connects\": %llu, \"disconnects\": %llu, "
+            "\"events\": %llu, \"fanout_lag_p50_ms\": %.3f, \"fanout_lag_p99_ms\": %.3f, \"fanout_lag_p999_ms\": %.3f, "
+            "\"fanout_lag_max_ms\": %.3f, \"clock_lag_samples\": %zu, \"clock_lag_p50_ms\": %.3f, \"clock_lag_p99_ms\": %.3f, "
+            "\"clock_lag_p999_ms\": %.3f}\n}\n",
+            subscribers, streaming, (unsigned long long)sseConnects, (unsigned long long)sseDisconnects,
+            (unsigned long long)sseEvents, fanoutLag.pct(50), fanoutLag.pct(99), fanoutLag.pct(99.9), fanoutLag.max(),
+            clockLag.us.size(), clockLag.pct(50), clockLag.pct(99), clockLag.pct(99.9));
+  }
+
+private:
+  sockaddr_in addr;
+  std::string host;
+  std::discrete_distribution<int> weights;
+  int think, timeout;
+  bool retryAfter;  // honor Retry-After on 503
+  std::mt19937 rng;
+  int ep;
+  std::vector<std::unique_ptr<Client>> clients;
+  EndpointStats stats[ENDPOINTS];
+  std::string lastSeq = "0";  // newest sequence seen in a readings response, for longpoll
+  // sse
+  uint64_t sseConnects = 0, sseDisconnects = 0, sseEvents = 0;
+  std::unordered_map<std::string, int64_t> firstSeen;  // event id -> first receipt, usecs
+  Samples fanoutLag, clockLag;
+
+  void start(Client *c, int64_t nowUs) {
+    c->fd = connectNonBlocking(addr);
+    c->in.clear();
+    c->outOff = 0;
+    c->connected = false;
+    c->startUs = nowUs;
+    std::string path;
+    if (c->sse) {
+      sseConnects++;
+      c->parser.reset();
+      c->out = "GET /events HTTP/1.1\r\nHost: " + host + "\r\nAccept: text/event-stream\r\n";
+      if (!c->parser.lastId.empty()) c->out += "Last-Event-ID: " + c->parser.lastId + "\r\n";
+      c->out += "\r\n";
+      c->deadline = nowUs + timeout * 1000LL;
+    } else {
+      c->endpoint = (Endpoint)weights(rng);
+      switch (c->endpoint) {
+        case INDEX: path = "/"; break;
+        case STATIC: path = staticFiles[rng() % (sizeof(staticFiles) / sizeof(staticFiles[0]))]; break;
+        case READINGS: path = "/readings"; break;
+        case LONGPOLL: path = "/readings?since=" + lastSeq; break;
+        case WEIGHT: path = "/weight"; break;
+        default: path = "/config"; break;
+      }
+      c->out = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+      c->deadline = nowUs + (timeout + (c->endpoint == LONGPOLL ? LONGPOLL_EXTRA : 0)) * 1000LL;
+      stats[c->endpoint].requests++;
+    }
+    if (c->fd < 0) {
+      finish(c, nowUs, 0);
+      return;
+    }
+    epollAdd(ep, c->fd, EPOLLOUT | EPOLLIN | EPOLLRDHUP, c);
+  }
+
+  // complete when the body reaches Content-Length, or at close when there is none
+  void response(Client *c, int64_t nowUs, bool open) {
+    size_t end = c->in.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string head = c->in.substr(0, end);
+    std::string len = httpHeader(head, "Content-Length");
+    if (open && (len.empty() || c->in.size() - end - 4 < (size_t)atol(len.c_str()))) return;
+    int status = httpStatus(head);
+    if (status == 200 && (c->endpoint == READINGS || c->endpoint == LONGPOLL)) {
+      size_t seq = c->in.find("\"seq\":", end);
+      if (seq != std::string::npos) lastSeq = std::to_string(strtoul(c->in.c_str() + seq + 6, nullptr, 10));
+    }
+    int wait = think;
+    if (status == 503 && retryAfter) {
+      std::string after = httpHeader(head, "Retry-After");
+      if (!after.empty()) wait = std::max(wait, atoi(after.c_str()) * 1000);
+    }
+    finish(c, nowUs, status, wait);
+  }
+
+  void sseData(Client *c, int64_t nowUs) {
+    if (!c->streaming) {
+      size_t end = c->in.find("\r\n\r\n");
+      if (end == std::string::npos) return;
+      if (httpStatus(c->in.substr(0, end)) != 200) {
+        finish(c, nowUs, 0);
+        return;
+      }
+      c->in.erase(0, end + 4);
+      c->streaming = true;
+    }
+    c->parser.feed(c->in.data(), c->in.size(), [&](const SseEvent &ev) {
+      if (ev.event != "new_readings" || ev.id.empty()) return;
+      sseEvents++;
+      auto it = firstSeen.find(ev.id);
+      if (it == firstSeen.end()) firstSeen[ev.id] = nowUs;
+      fanoutLag.add(it == firstSeen.end() ? 0 : nowUs - it->second);
+      size_t lu = ev.data.find("\"lastUpdate\":\"");
+      if (lu != std::string::npos) {
+        int64_t sent = atoll(ev.data.c_str() + lu + 14);
+        int64_t lag = wallMs() - sent;
+        // only meaningful when the node's clock is wall-clock time
+        if (lag >= 0 && lag < 86400000LL) clockLag.add(lag * 1000);
+      }
+    });
+    c->in.clear();
+  }
+
+  // status > 0: response received; 0: connection error; -1: timeout.
+  // The client's next request starts waitMs later (think time unless given).
+  void finish(Client *c, int64_t nowUs, int status, int waitMs = -1) {
+    if (c->fd >= 0) {
+      epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, nullptr);
+      close(c->fd);
+      c->fd = -1;
+    }
+    if (c->sse) {
+      if (c->streaming) sseDisconnects++;
+      c->streaming = false;
+      c->nextStart = nowUs + 1000000;  // reconnect like EventSource's retry: 1000
+      return;
+    }
+    EndpointStats &s = stats[c->endpoint];
+    if (status > 0) {
+      s.status[status]++;
+      s.latency.add(nowUs - c->startUs);
+      if (status >= 200 && status < 300) s.ok++;
+      else if (status == 503) s.busy++;
+      else s.errors++;
+    } else if (status == 0) {
+      s.errors++;
+    } else {
+      s.timeouts++;
+    }
+    c->nextStart = nowUs + (waitMs < 0 ? think : waitMs) * 1000LL;
+  }
+};
+
+// posts this host's clock to /browsertime the way the web page does; blocking, once
+static bool setClock(const sockaddr_in &addr, const std::string &host) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  timeval tv = {2, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  std::string body = "{\"timestamp\":" + std::to_string(wallMs()) + ",\"timezone\":\"UTC\",\"offset\":0,\"localTime\":\"loadgen\"}";
+  std::string req = "POST /browsertime HTTP/1.1\r\nHost: " + host +
+                    "\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\n\r\n" + body;
+  std::string in;
+  char buf[512];
+  ssize_t n;
+  if (connect(fd, (const sockaddr *)&addr, sizeof(addr)) == 0 && send(fd, req.data(), req.size(), 0) == (ssize_t)req.size()) {
+    while (in.find("\r\n\r\n") == std::string::npos && (n = recv(fd, buf, sizeof(buf), 0)) > 0) in.append(buf, n);
+  }
+  close(fd);
+  return httpStatus(in) == 200;
+}
+
+int main(int argc, char **argv) {
+  std::string target, mix = "index=5,static=10,readings=60,weight=20,config=5", label, output, busy;
+  int requesters = 4, subscribers = 0, think = 0, seconds = 10, timeout = 10000;
+  bool retryAfter = true, clock = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "u:c:m:e:w:RCB:d:T:l:o:")) != -1) {
+    switch (opt) {
+      case 'u': target = optarg; break;
+      case 'c': requesters = atoi(optarg); break;
+      case 'm': mix = optarg; break;
+      case 'e': subscribers = atoi(optarg); break;
+      case 'w': think = atoi(optarg); break;
+      case 'R': retryAfter = false; break;
+      case 'C': clock = true; break;
+      case 'B': busy = optarg; break;
+      case 'd': seconds = atoi(optarg); break;
+      case 'T': timeout = atoi(optarg); break;
+      case 'l': label = optarg; break;
+      case 'o': output = optarg; break;
+      default: target.clear(); break;
+    }
+  }
+  std::vector<int> weights;
+  sockaddr_in addr;
+  std::string host;
+  int expectBusy = -1;
+  if (!busy.empty()) {
+    expectBusy = std::find(endpointNames, endpointNames + ENDPOINTS, busy) - endpointNames;
+    if (expectBusy == ENDPOINTS) target.clear();
+  }
+  if (target.empty() || !parseMix(mix, weights)) {
+    fprintf(stderr, "usage: loadgen -u host[:port] [-c clients] [-m mix] [-e sse_clients] [-w think_ms] [-R] [-C]\n"
+                    "               [-B endpoint] [-d seconds] [-T timeout_ms] [-l label] [-o report.json]\n");
+    return 2;
+  }
+  if (!resolve(target, DEFAULT_PORT, addr, host)) {
+    fprintf(stderr, "cannot resolve %s\n", target.c_str());
+    return 1;
+  }
+  if (clock && !setClock(addr, host)) fprintf(stderr, "could not set the clock on %s, SSE clock lag may be missing\n", target.c_str());
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  LoadGen gen(addr, host, weights, think, timeout, retryAfter);
+  gen.addClients(requesters, subscribers);
+  int64_t start = monoUs(), end = start + seconds * 1000000LL;
+  std::vector<epoll_event> events(512);
+  while (!stopping && monoUs() < end) {
+    gen.tick(monoUs());
+    int n = epoll_wait(gen.epollFd(), events.data(), events.size(), 1);
+    int64_t now = monoUs();
+    for (int i = 0; i < n; i++) gen.onEvent((Client *)events[i].data.ptr, events[i].events, now);
+  }
+  double elapsed = (monoUs() - start) / 1e6;
+  FILE *out = output.empty() ? stdout : fopen(output.c_str(), "w");
+  if (!out) {
+    perror(output.c_str());
+    return 1;
+  }
+  gen.report(out, label, elapsed);
+  if (out != stdout) fclose(out);
+  return gen.passed(expectBusy) ? 0 : 1;
+}
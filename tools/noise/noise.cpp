@@ -0,0 +1,84 @@
+// Noise characterization of a recorded raw trace, with the firmware's own analysis (src/noise.h).
+//
+//   noise [-s sps] [-r runs] trace.csv
+//
+// The trace is what the firmware saves after a "noise" capture (http://<node>/noise.csv):
+// a "# samples=N seconds=S captured=C" header, then one raw value per line. It holds the
+// last NOISE_MAX_SAMPLES of the C captured, so long-tau figures can differ from /noise. Other traces work too:
+// lines of "raw" or "ms,raw" (the last field is used), with -s giving the sample rate
+// when there is no header. Prints the same JSON report as /noise; -r repeats the analysis
+// to time it on the host (the report's "us" figures are from the last run).
+
+#include "../../src/noise.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static uint32_t hostMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: noise [-s sps] [-r runs] trace.csv\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  float sps = 0;
+  int runs = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:r:")) != -1) {
+    switch (opt) {
+      case 's': sps = atof(optarg); break;
+      case 'r': runs = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+      default: usage();
+    }
+  }
+  if (optind != argc - 1) usage();
+  FILE *f = fopen(argv[optind], "r");
+  if (!f) {
+    perror(argv[optind]);
+    return 1;
+  }
+  std::vector<int32_t> y;
+  float seconds = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') {
+      const char *s = strstr(line, "seconds=");
+      if (s) seconds = atof(s + 8);
+      continue;
+    }
+    const char *field = strrchr(line, ',');
+    field = field ? field + 1 : line;
+    char *end;
+    long v = strtol(field, &end, 10);
+    if (end != field) y.push_back((int32_t)v);
+  }
+  fclose(f);
+  if (sps > 0 && y.size() > 1) seconds = (y.size() - 1) / sps;
+  if (y.size() < 3 || seconds <= 0) {
+    fprintf(stderr, "need at least 3 samples and a sample rate (header or -s)\n");
+    return 1;
+  }
+
+  std::vector<int32_t> scratch(NOISE_SCRATCH_WORDS);
+  NoiseReport r;
+  uint32_t start = hostMicros();
+  for (int i = 0; i < runs; i++) noiseAnalyze(y.data(), y.size(), seconds, r, scratch.data(), hostMicros);
+  uint32_t total = hostMicros() - start;
+
+  std::string out(2048, '\0');
+  int n = noiseJson(&out[0], out.size(), r);
+  out.resize(n < (int)out.size() ? n : out.size() - 1);
+  printf("%s\n", out.c_str());
+  if (runs > 1) fprintf(stderr, "%d runs, %.1f us per analysis\n", runs, (double)total / runs);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Checks src/stability.h against a brute-force window, then times it.
+//
+//   stability-check [-n samples] [-b bench_samples]
+//
+// A synthetic trace (noise, level steps, ramps, uneven sample spacing, and a clock that
+// starts just before the 32-bit millis() wrap) is fed sample by sample to a
+// StabilityWindow<64> and to a plain vector holding the same window, recomputed from
+// scratch each time. count, min, max, mean, slope and stable must agree after every
+// sample. Then bench_samples adds are timed. Exits 1 on any mismatch.
+
+#include "../../src/stability.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <random>
+#include <vector>
+
+#define CAPACITY 64
+#define WINDOW_MS 1500
+#define SPREAD 2000
+#define SLOPE 1000
+
+struct Sample {
+  uint32_t t;
+  int32_t raw;
+};
+
+struct Reference {
+  size_t count = 0;
+  int32_t min = 0, max = 0, mean = 0;
+  double slope = 0;
+  bool stable = false;
+};
+
+// the last CAPACITY samples within WINDOW_MS of the newest, from scratch
+static Reference reference(const std::vector<Sample> &all) {
+  Reference r;
+  uint32_t now = all.back().t;
+  size_t first = all.size();
+  while (first > 0 && all.size() - first < CAPACITY && now - all[first - 1].t <= WINDOW_MS) first--;
+  double n = all.size() - first, s = 0, st = 0, stt = 0, stv = 0;
+  r.count = all.size() - first;
+  r.min = r.max = all[first].raw;
+  for (size_t i = first; i < all.size(); i++) {
+    const Sample &p = all[i];
+    if (p.raw < r.min) r.min = p.raw;
+    if (p.raw > r.max) r.max = p.raw;
+    double dt = (double)(uint32_t)(p.t - all[first].t);
+    s += p.raw;
+    st += dt;
+    stt += dt * dt;
+    stv += dt * p.raw;
+  }
+  double den = n * stt - st * st;
+  r.slope = n < 2 || den == 0 ? 0 : 1000 * (n * stv - st * s) / den;
+  r.mean = (int32_t)(int64_t)(s / n);
+  r.stable = r.count >= StabilityWindow<CAPACITY>::MIN_SAMPLES && r.max - r.min <= SPREAD && fabs(r.slope) <= SLOPE;
+  return r;
+}
+
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long samples = 20000, bench = 10000000;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+    switch (opt) {
+      case 'n': samples = atol(optarg); break;
+      case 'b': bench = atol(optarg); break;
+      default:
+        fprintf(stderr, "usage: stability-check [-n samples] [-b bench_samples]\n");
+        return 2;
+    }
+  }
+
+  StabilityWindow<CAPACITY> w;
+  w.tolerances(WINDOW_MS, SPREAD, SLOPE);
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> gap(10, 130), noise(-800, 800);
+  std::vector<Sample> all;
+  uint32_t t = 4294960000u;  // wraps a few seconds in
+  long bad = 0, stable = 0;
+  for (long i = 0; i < samples; i++) {
+    t += gap(rng);
+    // alternate between two levels, with a ramp at the start of some stretches
+    int32_t raw = (i / 500 % 2 ? 800000 : 100000) + noise(rng) + (i % 700 < 50 ? (int32_t)(i * 37) : 0);
+    w.add(t, raw);
+    all.push_back({t, raw});
+    Reference r = reference(all);
+    // slope is float in the window, double here
+    bool slopeOk = fabs(w.slope() - r.slope) <= 1e-3 * fabs(r.slope) + 1e-2;
+    // stable may only differ where the slope sits on the tolerance
+    bool stableOk = w.stable() == r.stable || fabs(fabs(r.slope) - SLOPE) < 1;
+    if (w.count() != r.count || w.min() != r.min || w.max() != r.max || w.mean() != r.mean || !slopeOk || !stableOk) {
+      if (bad++ < 5)
+        printf("stability: sample %ld: count %u/%zu min %ld/%ld max %ld/%ld mean %ld/%ld slope %.3f/%.3f stable %d/%d\n",
+               i, (unsigned)w.count(), r.count, (long)w.min(), (long)r.min, (long)w.max(), (long)r.max, (long)w.mean(),
+               (long)r.mean, w.slope(), r.slope, w.stable(), r.stable);
+    }
+    if (r.stable) stable++;
+  }
+  printf("stability: %ld samples checked against brute force, %ld stable, %ld mismatches\n", samples, stable, bad);
+
+  double start = nowNs();
+  volatile int sink = 0;
+  for (long i = 0; i < bench; i++) {
+    w.add(t += 12, (int32_t)((uint32_t)i * 2654435761u >> 8));
+    sink = sink + w.stable();
+  }
+  if (bench > 0) printf("stability: %.1f ns per add + stable()\n", (nowNs() - start) / bench);
+  return bad ? 1 : 0;
+}
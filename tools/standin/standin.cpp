@@ -0,0 +1,390 @@
+// Stand-in for one or more coop feeder nodes, for exercising the host-side tools without
+// hardware. Each simulated node listens on its own port and mimics the firmware's endpoint
+// set: /events (new_readings events, Last-Event-ID replay from a small backlog), /readings
+// (including ?since= long-polling with a bounded number of parked requests), /weight,
+// /config, /host, /browsertime and the web page assets from the data directory.
+// All nodes share one epoll loop.
+//
+//   standin [-n nodes] [-a address] [-p base_port] [-i interval_ms] [-d drop_every] [-k restart_every]
+//           [-r data_dir] [-t seconds]
+//
+// -d closes every node's event streams after that many samples, like a WiFi blip. -k restarts
+// every node after that many samples: seq starts over, the backlog is lost and event ids
+// jump past the last block, as the firmware's do after a reboot.
+
+#include "../common/http.h"
+#include "../common/net.h"
+
+#include <signal.h>
+
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#define BACKLOG_EVENTS 64
+#define EVENTS_ID_BLOCK 4096  // the firmware's event id reservation
+// same limits as the firmware's /readings?since=
+#define LONGPOLL_MAX 8
+#define LONGPOLL_TIMEOUT 30000
+
+static volatile sig_atomic_t stopping = 0;
+static void onSignal(int) { stopping = 1; }
+
+struct SimNode;
+
+// epoll cookie: either a listening socket or a client connection
+struct Handle {
+  enum Kind { LISTENER, CONN } kind;
+  int fd = -1;
+  SimNode *node = nullptr;
+  explicit Handle(Kind k) : kind(k) {}
+};
+
+struct Conn : Handle {
+  Conn() : Handle(CONN) {}
+  std::string in, out;
+  size_t outOff = 0;
+  bool sse = false;
+  bool closeWhenFlushed = false;
+};
+
+struct SimNode {
+  int port = 0;
+  uint32_t seq = 0;
+  uint32_t idBase = 0;  // event id = idBase + seq, raised on every restart
+  int level = 100;   // feed level %
+  std::deque<std::pair<uint32_t, std::string>> backlog;  // id -> serialized event
+  std::set<Conn *> subscribers;
+  std::map<Conn *, int64_t> parked;  // long-poll request -> monotonic deadline
+  Handle listener{Handle::LISTENER};
+};
+
+// value of a query parameter in path, "" if absent
+static std::string queryParam(const std::string &path, const char *name) {
+  size_t q = path.find('?');
+  std::string key = std::string(name) + "=";
+  while (q != std::string::npos) {
+    size_t start = q + 1;
+    size_t end = path.find('&', start);
+    if (path.compare(start, key.size(), key) == 0)
+      return path.substr(start + key.size(), end == std::string::npos ? std::string::npos : end - start - key.size());
+    q = end;
+  }
+  return "";
+}
+
+static bool hasParam(const std::string &path, const char *name) {
+  size_t q = path.find('?');
+  if (q == std::string::npos) return false;
+  std::string query = "&" + path.substr(q + 1) + "&";
+  std::string n = std::string("&") + name;
+  size_t at = query.find(n);
+  return at != std::string::npos && (query[at + n.size()] == '&' || query[at + n.size()] == '=');
+}
+
+class Standin {
+public:
+  explicit Standin(const std::string &dataDir) : dataDir(dataDir) { ep = epoll_create1(EPOLL_CLOEXEC); }
+
+  bool addNode(const sockaddr_in &addr) {
+    nodes.emplace_back(new SimNode());
+    SimNode *n = nodes.back().get();
+    n->port = ntohs(addr.sin_port);
+    n->listener.node = n;
+    n->listener.fd = listenNonBlocking(addr);
+    if (n->listener.fd < 0) return false;
+    return epollAdd(ep, n->listener.fd, EPOLLIN, &n->listener);
+  }
+
+  // one new sample on every node
+  void tick(int dropEvery, int restartEvery) {
+    for (auto &p : nodes) {
+      SimNode *n = p.get();
+      if (restartEvery && n->seq >= (uint32_t)restartEvery) restart(n);
+      n->seq++;
+      // slow drain with a refill when empty
+      if (n->seq % 10 == 0) n->level--;
+      if (n->level < 0) n->level = 100;
+      char data[128];
+      snprintf(data, sizeof(data), "{\"loadcell\":\"%d\",\"units\":\"%%\",\"seq\":%u,\"lastUpdate\":\"%lld\"}",
+               n->level, n->seq, (long long)wallMs());
+      uint32_t id = n->idBase + n->seq;
+      std::string ev = "id: " + std::to_string(id) + "\nevent: new_readings\ndata: " + data + "\n\n";
+      n->backlog.emplace_back(id, ev);
+      if (n->backlog.size() > BACKLOG_EVENTS) n->backlog.pop_front();
+      std::vector<Conn *> subs(n->subscribers.begin(), n->subscribers.end());
+      for (Conn *c : subs) {
+        if (dropEvery && n->seq % dropEvery == 0) {
+          closeConn(c);
+          continue;
+        }
+        c->out += ev;
+        write(c);
+      }
+      // wake every parked long-poll
+      std::vector<Conn *> waiting;
+      for (auto &w : n->parked) waiting.push_back(w.first);
+      n->parked.clear();
+      for (Conn *c : waiting) {
+        respond(c, 200, "application/json", readingsFor(n));
+        write(c);
+      }
+    }
+  }
+
+  // a reboot: connections drop, seq and backlog start over, and ids continue above the
+  // block the last run had reserved, so they never repeat
+  void restart(SimNode *n) {
+    std::vector<Conn *> conns(n->subscribers.begin(), n->subscribers.end());
+    for (auto &w : n->parked) conns.push_back(w.first);
+    for (Conn *c : conns) closeConn(c);
+    n->idBase = (n->idBase + n->seq + EVENTS_ID_BLOCK - 1) / EVENTS_ID_BLOCK * EVENTS_ID_BLOCK;
+    n->seq = 0;
+    n->backlog.clear();
+  }
+
+  // answer long-polls whose timeout has passed with the current readings
+  void expire(int64_t now) {
+    for (auto &p : nodes) {
+      SimNode *n = p.get();
+      for (auto it = n->parked.begin(); it != n->parked.end();) {
+        Conn *c = it->first;
+        if (now < it->second) {
+          ++it;
+          continue;
+        }
+        it = n->parked.erase(it);
+        respond(c, 200, "application/json", readingsFor(n));
+        write(c);
+      }
+    }
+  }
+
+  void onEvent(Handle *h, uint32_t events) {
+    if (h->kind == Handle::LISTENER) {
+      accept(h);
+      return;
+    }
+    Conn *c = (Conn *)h;
+    if (c->fd < 0) return;  // closed earlier in this batch
+    if (events & EPOLLIN) {
+      if (!readAll(c->fd, c->in)) {
+        closeConn(c);
+        return;
+      }
+      if (!c->sse && !c->closeWhenFlushed) request(c);
+    }
+    if (c->fd < 0) return;
+    if (events & EPOLLOUT) write(c);
+    else if (events & (EPOLLERR | EPOLLHUP)) closeConn(c);
+  }
+
+  int epollFd() const { return ep; }
+
+  // free connections closed during the last epoll batch
+  void reap() {
+    for (Conn *c : dead) delete c;
+    dead.clear();
+  }
+
+private:
+  int ep;
+  std::vector<std::unique_ptr<SimNode>> nodes;
+  std::vector<Conn *> dead;
+  std::string dataDir;
+  std::map<std::string, std::string> files;  // cached data directory contents
+
+  void accept(Handle *l) {
+    for (;;) {
+      int fd = accept4(l->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) return;
+      Conn *c = new Conn();
+      c->fd = fd;
+      c->node = l->node;
+      epollAdd(ep, fd, EPOLLIN | EPOLLRDHUP, c);
+    }
+  }
+
+  void request(Conn *c) {
+    size_t end = c->in.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string head = c->in.substr(0, end);
+    c->in.erase(0, end + 4);
+    size_t sp1 = head.find(' '), sp2 = head.find(' ', sp1 + 1);
+    std::string path = head.substr(sp1 + 1, sp2 - sp1 - 1);
+    SimNode *n = c->node;
+    if (path == "/events") {
+      c->sse = true;
+      c->out = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n";
+      c->out += "retry: 1000\ndata: hello!\n\n";
+      // replay what is still in the backlog after the client's last id, like the firmware:
+      // a "gap" event first if ids were lost (aged out, or the node restarted), starting
+      // from 0 for an id this node never issued
+      std::string last = httpHeader(head, "Last-Event-ID");
+      if (!last.empty() && !n->backlog.empty()) {
+        uint32_t lastId = strtoul(last.c_str(), nullptr, 10);
+        uint32_t oldest = n->backlog.front().first;
+        uint32_t from = lastId > n->backlog.back().first ? 0 : lastId + 1;
+        if (from < oldest) {
+          char gap[64];
+          snprintf(gap, sizeof(gap), "event: gap\ndata: {\"from\":%u,\"to\":%u}\n\n", from, oldest - 1);
+          c->out += gap;
+        }
+        if (from == 0) lastId = 0;
+        for (auto &e : n->backlog) {
+          if (e.first > lastId) c->out += e.second;
+        }
+      }
+      n->subscribers.insert(c);
+    } else if (path.compare(0, 9, "/readings") == 0) {
+      std::string since = queryParam(path, "since");
+      if (!since.empty() && strtoul(since.c_str(), nullptr, 10) == n->seq) {
+        if (n->parked.size() >= LONGPOLL_MAX) {
+          respond(c, 503, "text/plain", "too many waiting requests", "Retry-After: 1\r\n");
+        } else {
+          int64_t timeout = LONGPOLL_TIMEOUT;
+          std::string t = queryParam(path, "timeout");
+          if (!t.empty()) timeout = std::min<int64_t>(atol(t.c_str()), LONGPOLL_TIMEOUT);
+          n->parked[c] = monoMs() + timeout;
+          c->closeWhenFlushed = true;  // no more requests on this connection
+          return;
+        }
+      } else {
+        respond(c, 200, "application/json", readingsFor(n));
+      }
+    } else if (path == "/weight") {
+      respond(c, 200, "text/plain", std::to_string(n->level));
+    } else if (path.compare(0, 7, "/config") == 0) {
+      std::string response = "none";
+      if (hasParam(path, "webtimer")) response = "change web timer to " + queryParam(path, "webtimer");
+      respond(c, 200, "text/plain", response);
+    } else if (path == "/host") {
+      respond(c, 200, "text/plain", "hostname: standin" + std::to_string(n->port) + ", ESP local MAC addr: 00:00:00:00:00:00");
+    } else if (path == "/browsertime") {
+      respond(c, 200, "text/plain", "Time received");
+    } else {
+      std::string file = path == "/" ? "/index.html" : path.substr(0, path.find('?'));
+      const std::string *body = load(file);
+      if (body) respond(c, 200, contentType(file), *body);
+      else respond(c, 404, "text/plain", "Not found");
+    }
+    write(c);
+  }
+
+  // file from the data directory, cached; nullptr if missing
+  const std::string *load(const std::string &file) {
+    if (file.find("..") != std::string::npos) return nullptr;
+    auto it = files.find(file);
+    if (it != files.end()) return &it->second;
+    std::ifstream f(dataDir + file, std::ios::binary);
+    if (!f) return nullptr;
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    return &(files[file] = ss.str());
+  }
+
+  static const char *contentType(const std::string &file) {
+    auto ends = [&](const char *ext) {
+      size_t n = strlen(ext);
+      return file.size() >= n && file.compare(file.size() - n, n, ext) == 0;
+    };
+    if (ends(".html")) return "text/html";
+    if (ends(".css")) return "text/css";
+    if (ends(".js")) return "application/javascript";
+    if (ends(".png")) return "image/png";
+    if (ends(".ico")) return "image/x-icon";
+    return "application/octet-stream";
+  }
+
+  std::string readingsFor(SimNode *n) {
+    char data[128];
+    snprintf(data, sizeof(data), "{\"loadcell\":\"%d\",\"units\":\"%%\",\"seq\":%u,\"lastUpdate\":\"%lld\"}",
+             n->level, n->seq, (long long)wallMs());
+    return data;
+  }
+
+  void respond(Conn *c, int status, const char *type, const std::string &body, const std::string &extra = "") {
+    c->out = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") + "\r\nContent-Type: " + type +
+             "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nAccess-Control-Allow-Origin: *\r\n" + extra +
+             "Connection: close\r\n\r\n" + body;
+    c->closeWhenFlushed = true;
+  }
+
+  void write(Conn *c) {
+    if (!flushOut(c->fd, c->out, c->outOff)) {
+      closeConn(c);
+      return;
+    }
+    if (c->out.empty() && c->closeWhenFlushed) {
+      closeConn(c);
+      return;
+    }
+    epollMod(ep, c->fd, EPOLLIN | EPOLLRDHUP | (c->out.empty() ? 0 : (uint32_t)EPOLLOUT), c);
+  }
+
+  void closeConn(Conn *c) {
+    if (c->fd < 0) return;
+    c->node->subscribers.erase(c);
+    c->node->parked.erase(c);
+    epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, nullptr);
+    close(c->fd);
+    c->fd = -1;
+    // freed by reap() so a cookie already returned by this epoll_wait batch never dangles
+    dead.push_back(c);
+  }
+};
+
+int main(int argc, char **argv) {
+  int count = 1, basePort = 8080, interval = 1000, dropEvery = 0, restartEvery = 0, seconds = 0;
+  std::string address = "127.0.0.1", dataDir = "data";
+  int opt;
+  while ((opt = getopt(argc, argv, "n:a:p:i:d:k:r:t:")) != -1) {
+    switch (opt) {
+      case 'n': count = atoi(optarg); break;
+      case 'a': address = optarg; break;
+      case 'p': basePort = atoi(optarg); break;
+      case 'i': interval = atoi(optarg); break;
+      case 'd': dropEvery = atoi(optarg); break;
+      case 'k': restartEvery = atoi(optarg); break;
+      case 'r': dataDir = optarg; break;
+      case 't': seconds = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: standin [-n nodes] [-a address] [-p base_port] [-i interval_ms] [-d drop_every] [-k restart_every]\n"
+                        "               [-r data_dir] [-t seconds]\n");
+        return 2;
+    }
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+  Standin standin(dataDir);
+  for (int i = 0; i < count; i++) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(basePort + i);
+    inet_pton(AF_INET, address.c_str(), &addr.sin_addr);
+    if (!standin.addNode(addr)) {
+      fprintf(stderr, "cannot listen on %s:%d: %s\n", address.c_str(), basePort + i, strerror(errno));
+      return 1;
+    }
+  }
+  fprintf(stderr, "%d nodes on %s:%d-%d\n", count, address.c_str(), basePort, basePort + count - 1);
+  int64_t start = monoMs(), nextTick = start;
+  std::vector<epoll_event> events(256);
+  while (!stopping && (!seconds || monoMs() - start < seconds * 1000LL)) {
+    int64_t now = monoMs();
+    if (now >= nextTick) {
+      standin.tick(dropEvery, restartEvery);
+      nextTick += interval;
+    }
+    int n = epoll_wait(standin.epollFd(), events.data(), events.size(), (int)std::max<int64_t>(0, nextTick - now));
+    for (int i = 0; i < n; i++) standin.onEvent((Handle *)events[i].data.ptr, events[i].events);
+    standin.expire(monoMs());
+    standin.reap();
+  }
+  return 0;
+}